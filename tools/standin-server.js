@@ -0,0 +1,458 @@
+// Local stand-in for the ShellInABox backend, for exercising the web client
+// without a Telehack connection. It serves www/ and answers both the
+// long-poll protocol and the WebSocket transport with a full-screen
+// animation wrapped in synchronized output (DECSET 2026).
+//
+// WebSocket messages are binary; the first byte is the frame type:
+//   1 output (server to client, raw terminal bytes)
+//   2 keys (client to server, UTF-8)
+//   3 resize (client to server, 16-bit big-endian width and height)
+//   4 session (server to client, session id)
+//   5 closed (server to client)
+//   6 terminal response (client to server, UTF-8)
+//   7 receive window (client to server, 32-bit big-endian byte count)
+// The initial width, height, window and session or rooturl go in the query
+// string.
+//
+// A long poll with "stream=1" is answered as application/x-shellinabox-stream:
+// the same frame types, each as one type byte and a 32-bit big-endian payload
+// length, written as output is produced. The response starts with a session
+// frame and ends after a closed frame, an idle timeout, or once it has carried
+// the poll's receive window.
+//
+// Polls carry a "window" of how many output bytes the client can take. While
+// more than that is pending, or no poll is outstanding, or a socket's window
+// is zero, new animation frames replace the pending ones rather than queue
+// behind them; the status line counts the frames skipped.
+//
+// Long-poll key requests may carry a "seq" number; they are then applied in
+// sequence order, duplicates are dropped, and the reply echoes it in an
+// X-ShellInABox-Seq header so the client knows it may pipeline and retry.
+//
+//   node tools/standin-server.js [port]
+//
+// Then open http://localhost:4200/Telehack.html. Keys: "s" toggles
+// synchronized output, "p" pauses the animation, "q" ends the session.
+
+var http = require('http');
+var fs = require('fs');
+var path = require('path');
+var crypto = require('crypto');
+var querystring = require('querystring');
+
+var port = parseInt(process.argv[2], 10) || 4200;
+var root = path.join(__dirname, '..', 'www');
+var types = { '.html': 'text/html', '.js': 'text/javascript', '.css': 'text/css', '.png': 'image/png', '.gif': 'image/gif' };
+var sessions = {};
+
+function Session(width, height) {
+    this.id = crypto.randomBytes(12).toString('hex');
+    this.width = width;
+    this.height = height;
+    this.output = '';
+    this.window = 65536;
+    this.frameOffset = -1;
+    this.skipped = 0;
+    this.poll = null;
+    this.socket = null;
+    this.nextSeq = 0;
+    this.keyBatches = {};
+    this.frame = 0;
+    this.synchronized = true;
+    this.paused = false;
+    this.closed = false;
+    this.timer = setInterval(function(session) { return function() { session.tick(); }; }(this), 33);
+    this.write('\u001B[?1049h\u001B[?25l');
+}
+
+Session.prototype.write = function(s) {
+    this.output += s;
+    this.frameOffset = -1;
+    this.flushPoll();
+};
+
+Session.prototype.writeFrame = function(s) {
+    if (this.frameOffset < 0) {
+        this.frameOffset = this.output.length;
+    } else if (this.output.length + s.length > this.window) {
+        this.output = this.output.substring(0, this.frameOffset);
+        this.skipped++;
+    }
+    this.output += s;
+    this.flushPoll();
+};
+
+Session.prototype.takeOutput = function() {
+    var data = Buffer.from(this.output, 'utf8');
+    this.output = '';
+    this.frameOffset = -1;
+    return data;
+};
+
+Session.prototype.tick = function() {
+    if (this.paused) {
+        return;
+    }
+    var s = this.synchronized ? '\u001B[?2026h\u001B[H' : '\u001B[H';
+    for (var y = 0; y < this.height; y++) {
+        var line = '';
+        for (var x = 0; x < this.width; x++) {
+            var c = (x + y + this.frame) % 24;
+            line += '\u001B[48;5;' + (232 + c) + 'm' + (((x * 7 + y * 13 + this.frame) % 29) ? ' ' : '*');
+        }
+        s += line + '\u001B[0m' + (y < this.height - 1 ? '\r\n' : '');
+    }
+    var status = ' frame ' + this.frame + '  skipped ' + this.skipped + (this.synchronized ? '  sync on ' : '  sync off') + '  [s]ync [p]ause [q]uit ';
+    s += '\u001B[1;1H\u001B[7m' + status + '\u001B[0m';
+    if (this.synchronized) {
+        s += '\u001B[?2026l';
+    }
+    this.frame++;
+    this.writeFrame(s);
+};
+
+Session.prototype.keys = function(keys) {
+    for (var i = 0; i < keys.length; i++) {
+        switch (keys.charAt(i)) {
+        case 's':
+            this.synchronized = !this.synchronized;
+            break;
+        case 'p':
+            this.paused = !this.paused;
+            break;
+        case 'q':
+            this.close();
+            return;
+        }
+    }
+};
+
+Session.prototype.keyBatch = function(seq, keys) {
+    if (seq >= this.nextSeq + 4) {
+        return false;
+    }
+    if (seq >= this.nextSeq) {
+        this.keyBatches[seq] = keys;
+    }
+    while (this.nextSeq in this.keyBatches) {
+        keys = this.keyBatches[this.nextSeq];
+        delete this.keyBatches[this.nextSeq++];
+        this.keys(keys);
+    }
+    return true;
+};
+
+Session.prototype.close = function() {
+    clearInterval(this.timer);
+    this.closed = true;
+    this.write('\u001B[?25h\u001B[?1049l');
+};
+
+Session.prototype.flushPoll = function() {
+    if (this.socket) {
+        if (this.window <= 0 && !this.closed) {
+            return;
+        }
+        if (this.output) {
+            this.socket.send(1, this.takeOutput());
+        }
+        if (this.closed) {
+            this.socket.send(5, Buffer.alloc(0));
+            this.socket.close();
+            delete sessions[this.id];
+        }
+        return;
+    }
+    var poll = this.poll;
+    if (poll && poll.stream) {
+        if (this.output) {
+            var output = this.takeOutput();
+            writeStreamFrame(poll.response, 1, output);
+            poll.sent += output.length;
+        }
+        if (this.closed) {
+            this.poll = null;
+            clearTimeout(poll.timeout);
+            writeStreamFrame(poll.response, 5, Buffer.alloc(0));
+            poll.response.end();
+            delete sessions[this.id];
+        } else if (poll.sent >= this.window) {
+            this.poll = null;
+            clearTimeout(poll.timeout);
+            poll.response.end();
+        }
+        return;
+    }
+    if (!poll || !this.output && !this.closed) {
+        return;
+    }
+    this.poll = null;
+    clearTimeout(poll.timeout);
+    var data = this.takeOutput();
+    var session = this.closed ? '' : this.id;
+    if (this.closed) {
+        delete sessions[this.id];
+    }
+    if (poll.binary) {
+        var headers = { 'Content-Type': 'application/octet-stream', 'Cache-Control': 'no-cache' };
+        if (session) {
+            headers['X-ShellInABox-Session'] = session;
+        }
+        poll.response.writeHead(200, headers);
+        poll.response.end(data);
+    } else {
+        poll.response.writeHead(200, { 'Content-Type': 'application/json; charset=utf-8', 'Cache-Control': 'no-cache' });
+        poll.response.end(JSON.stringify({ session: session, data: data.toString('latin1') }));
+    }
+};
+
+function WebSocketConnection(socket) {
+    this.socket = socket;
+    this.buffer = Buffer.alloc(0);
+    this.fragments = [];
+    this.onframe = null;
+    this.onclose = null;
+    socket.on('data', function(connection) { return function(data) { connection.receive(data); }; }(this));
+    socket.on('close', function(connection) { return function() { if (connection.onclose) { connection.onclose(); } }; }(this));
+    socket.on('error', function() {});
+}
+
+WebSocketConnection.prototype.receive = function(data) {
+    this.buffer = Buffer.concat([this.buffer, data]);
+    while (this.buffer.length >= 2) {
+        var opcode = this.buffer[0] & 0x0F;
+        var fin = this.buffer[0] & 0x80;
+        var masked = this.buffer[1] & 0x80;
+        var length = this.buffer[1] & 0x7F;
+        var offset = 2;
+        if (length == 126) {
+            if (this.buffer.length < 4) {
+                return;
+            }
+            length = this.buffer.readUInt16BE(2);
+            offset = 4;
+        } else if (length == 127) {
+            if (this.buffer.length < 10) {
+                return;
+            }
+            length = this.buffer.readUInt32BE(6);
+            offset = 10;
+        }
+        if (this.buffer.length < offset + (masked ? 4 : 0) + length) {
+            return;
+        }
+        var mask = masked ? this.buffer.slice(offset, offset + 4) : null;
+        offset += masked ? 4 : 0;
+        var payload = Buffer.from(this.buffer.slice(offset, offset + length));
+        this.buffer = this.buffer.slice(offset + length);
+        for (var i = 0; mask && i < payload.length; i++) {
+            payload[i] ^= mask[i & 3];
+        }
+        if (opcode == 0x8) {
+            this.close();
+            return;
+        } else if (opcode == 0x9) {
+            this.write(0xA, payload);
+        } else if (opcode == 0x0 || opcode == 0x1 || opcode == 0x2) {
+            this.fragments.push(payload);
+            if (fin) {
+                var message = Buffer.concat(this.fragments);
+                this.fragments = [];
+                if (message.length && this.onframe) {
+                    this.onframe(message[0], message.slice(1));
+                }
+            }
+        }
+    }
+};
+
+WebSocketConnection.prototype.write = function(opcode, payload) {
+    var header;
+    if (payload.length < 126) {
+        header = Buffer.from([0x80 | opcode, payload.length]);
+    } else if (payload.length < 65536) {
+        header = Buffer.from([0x80 | opcode, 126, payload.length >> 8, payload.length & 0xFF]);
+    } else {
+        header = Buffer.alloc(10);
+        header[0] = 0x80 | opcode;
+        header[1] = 127;
+        header.writeUInt32BE(payload.length, 6);
+    }
+    this.socket.write(Buffer.concat([header, payload]));
+};
+
+WebSocketConnection.prototype.send = function(type, payload) {
+    this.write(0x2, Buffer.concat([Buffer.from([type]), payload]));
+};
+
+WebSocketConnection.prototype.close = function() {
+    if (!this.socket.destroyed) {
+        this.write(0x8, Buffer.alloc(0));
+        this.socket.end();
+    }
+};
+
+function handleUpgrade(request, socket) {
+    var params = querystring.parse(request.url.replace(/^[^?]*\??/, ''));
+    var session = params.session ? sessions[params.session] : null;
+    var key = request.headers['sec-websocket-key'];
+    if (!key || params.session && !session) {
+        socket.end('HTTP/1.1 400 Bad Request\r\n\r\n');
+        return;
+    }
+    socket.write('HTTP/1.1 101 Switching Protocols\r\n' + 'Upgrade: websocket\r\n' + 'Connection: Upgrade\r\n' +
+        'Sec-WebSocket-Accept: ' + crypto.createHash('sha1').update(key + '258EAFA5-E914-47DA-95CA-C5AB0DC85B11').digest('base64') + '\r\n\r\n');
+    if (!session) {
+        session = new Session(parseInt(params.width, 10) || 80, parseInt(params.height, 10) || 24);
+        sessions[session.id] = session;
+    }
+    session.window = params.window != undefined ? parseInt(params.window, 10) : 65536;
+    if (session.socket) {
+        session.socket.onclose = null;
+        session.socket.close();
+    }
+    var connection = new WebSocketConnection(socket);
+    session.socket = connection;
+    connection.onframe = function(type, payload) {
+        switch (type) {
+        case 2:
+            session.keys(payload.toString('utf8'));
+            break;
+        case 3:
+            session.width = payload.readUInt16BE(0);
+            session.height = payload.readUInt16BE(2);
+            break;
+        case 7:
+            session.window = payload.readUInt32BE(0);
+            session.flushPoll();
+            break;
+        }
+    };
+    connection.onclose = function() {
+        if (session.socket == connection) {
+            session.socket = null;
+        }
+    };
+    connection.send(4, Buffer.from(session.id));
+    session.flushPoll();
+}
+
+function writeStreamFrame(response, type, payload) {
+    var header = Buffer.alloc(5);
+    header[0] = type;
+    header.writeUInt32BE(payload.length, 1);
+    response.write(Buffer.concat([header, payload]));
+}
+
+function decodeKeys(hex) {
+    return Buffer.from(hex, 'hex').toString('utf8');
+}
+
+function handlePost(request, response, body) {
+    var params = querystring.parse(body);
+    var session = params.session ? sessions[params.session] : null;
+    var width = parseInt(params.width, 10) || 80;
+    var height = parseInt(params.height, 10) || 24;
+    if (params.keys != undefined) {
+        var headers = { 'Cache-Control': 'no-cache' };
+        if (session && params.seq != undefined) {
+            if (session.keyBatch(parseInt(params.seq, 10), decodeKeys(params.keys))) {
+                headers['X-ShellInABox-Seq'] = params.seq;
+            } else {
+                session.close();
+                session = null;
+            }
+        } else if (session) {
+            session.keys(decodeKeys(params.keys));
+        }
+        response.writeHead(session ? 200 : 400, headers);
+        response.end();
+        return;
+    }
+    if (params.session && !session) {
+        response.writeHead(400, { 'Cache-Control': 'no-cache' });
+        response.end();
+        return;
+    }
+    if (!session) {
+        session = new Session(width, height);
+        sessions[session.id] = session;
+    }
+    session.width = width;
+    session.height = height;
+    session.window = params.window != undefined ? parseInt(params.window, 10) : 65536;
+    if (session.poll) {
+        if (session.poll.stream) {
+            session.poll.response.end();
+        } else {
+            session.poll.response.writeHead(400);
+            session.poll.response.end();
+        }
+        clearTimeout(session.poll.timeout);
+    }
+    if (params.stream == '1') {
+        response.writeHead(200, { 'Content-Type': 'application/x-shellinabox-stream', 'Cache-Control': 'no-cache' });
+        writeStreamFrame(response, 4, Buffer.from(session.id));
+        var poll = {
+            response: response,
+            stream: true,
+            sent: 0,
+            timeout: setTimeout(function() {
+                if (session.poll == poll) {
+                    session.poll = null;
+                }
+                response.end();
+            }, 30000)
+        };
+        session.poll = poll;
+        response.on('close', function() {
+            if (session.poll == poll) {
+                session.poll = null;
+                clearTimeout(poll.timeout);
+            }
+        });
+        session.flushPoll();
+        return;
+    }
+    session.poll = {
+        response: response,
+        binary: params.binary == '1',
+        timeout: setTimeout(function() {
+            session.poll = null;
+            response.writeHead(200, params.binary == '1' ? { 'Content-Type': 'application/octet-stream', 'X-ShellInABox-Session': session.id } : { 'Content-Type': 'application/json' });
+            response.end(params.binary == '1' ? '' : JSON.stringify({ session: session.id, data: '' }));
+        }, 30000)
+    };
+    session.flushPoll();
+}
+
+var server = http.createServer(function(request, response) {
+    if (request.method == 'POST') {
+        var body = '';
+        request.on('data', function(chunk) { body += chunk; });
+        request.on('end', function() { handlePost(request, response, body); });
+        return;
+    }
+    var file = path.normalize(path.join(root, decodeURIComponent(request.url.replace(/[?#].*/, '')) || '/'));
+    if (file.indexOf(root) != 0) {
+        response.writeHead(403);
+        response.end();
+        return;
+    }
+    if (file == root + path.sep) {
+        file = path.join(root, 'Telehack.html');
+    }
+    fs.readFile(file, function(err, data) {
+        if (err) {
+            response.writeHead(404);
+            response.end();
+            return;
+        }
+        response.writeHead(200, { 'Content-Type': types[path.extname(file)] || 'application/octet-stream' });
+        response.end(data);
+    });
+});
+server.on('upgrade', handleUpgrade);
+server.listen(port, function() {
+    console.log('Stand-in ShellInABox server on http://localhost:' + port + '/Telehack.html');
+});
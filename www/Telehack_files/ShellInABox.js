@@ -8,23 +8,19 @@ function VT100(container) {
     }
     this.getUserSettings();
     this.initializeElements(container);
-    this.maxScrollbackLines = 500;
-    this.npar = 0;
-    this.par = [];
-    this.isQuestionMark = false;
-    this.savedX = [];
-    this.savedY = [];
-    this.savedAttr = [];
-    this.savedUseGMap = 0;
-    this.savedGMap = [this.Latin1Map, this.VT100GraphicsMap, this.CodePage437Map, this.DirectToFontMap];
-    this.savedValid = [];
-    this.respondString = '';
-    this.statusString = '';
+    this.maxScrollbackLines = typeof scrollbackLines != 'undefined' && scrollbackLines > 0 ? Math.floor(scrollbackLines) : 10000;
     this.internalClipboard = undefined;
     this.reset(true);
+    if (typeof useWorkerParser != 'undefined' && useWorkerParser && typeof Worker != 'undefined') {
+        this.startWorker();
+    }
 }
 
 VT100.prototype.reset = function(clearHistory) {
+    if (this.worker) {
+        this.worker.postMessage({ reset: !!clearHistory });
+        return;
+    }
     this.isEsc = 0;
     this.needWrap = false;
     this.autoWrapMode = true;
@@ -41,11 +37,11 @@ VT100.prototype.reset = function(clearHistory) {
         this.printWin.close();
     }
     this.printWin = null;
+    this.setSynchronizedOutput(false);
     this.utfEnabled = this.utfPreferred;
     this.utfCount = 0;
     this.utfChar = 0;
-    this.color = 'ansi0 bgAnsi15';
-    this.style = '';
+    this.utfDecoder = typeof TextDecoder != 'undefined' ? new TextDecoder('utf-8') : null;
     this.attr = 0x00F0;
     this.useGMap = 0;
     this.GMap = [this.Latin1Map, this.VT100GraphicsMap, this.CodePage437Map, this.DirectToFontMap];
@@ -59,6 +55,18 @@ VT100.prototype.reset = function(clearHistory) {
             while (this.console[i].firstChild) {
                 this.console[i].removeChild(this.console[i].firstChild);
             }
+            this.lines[i] = [];
+        }
+        this.scrollback = [];
+        this.scrollbackStart = 0;
+        this.scrollbackLength = 0;
+        this.scrollbackTotal = 0;
+        this.scrollbackCache = {};
+        this.discardedNodes = [];
+        this.numScrollbackLines = 0;
+        if (this.canvas) {
+            this.canvasRows = [];
+            this.cellSelection = null;
         }
     }
     this.enableAlternateScreen(false);
@@ -66,7 +74,7 @@ VT100.prototype.reset = function(clearHistory) {
     this.showCursor();
     this.isInverted = false;
     this.refreshInvertedState();
-    this.clearRegion(0, 0, this.terminalWidth, this.terminalHeight, this.color, this.style);
+    this.clearRegion(0, 0, this.terminalWidth, this.terminalHeight, this.attr);
 };
 VT100.prototype.addListener = function(elem, event, listener) {
     if (elem.addEventListener) {
@@ -194,6 +202,10 @@ VT100.prototype.initializeUserCSSStyles = function() {
                                             sheet.disabled = true;
                                         }
                                         userCSSList[i][2] = !sheet.disabled;
+                                        if (vt100.canvas) {
+                                            vt100.resetGlyphs();
+                                            vt100.scheduleRender();
+                                        }
                                     }
                                 }
                                 entry = entry.nextSibling;
@@ -249,6 +261,26 @@ VT100.prototype.initializeElements = function(container) {
     this.space = this.getChildById(this.container, 'space');
     this.input = this.getChildById(this.container, 'input');
     this.cliphelper = this.getChildById(this.container, 'cliphelper');
+    this.canvas = null;
+    if (typeof useCanvasRenderer != 'undefined' && useCanvasRenderer) {
+        var canvas = document.createElement('canvas');
+        if (canvas.getContext && canvas.getContext('2d')) {
+            canvas.id = 'screen';
+            this.scrollable.insertBefore(canvas, this.padding);
+            this.canvas = canvas;
+            this.canvasContext = canvas.getContext('2d');
+            this.canvasRows = [];
+            this.glyphPages = [];
+            this.glyphVariant = '';
+            this.cellSelection = null;
+            this.selectAnchor = null;
+            this.resetGlyphs();
+            this.printMirror = document.createElement('pre');
+            this.printMirror.id = 'printmirror';
+            this.scrollable.insertBefore(this.printMirror, this.padding);
+            this.addListener(window, 'beforeprint', function(vt100) { return function() { vt100.updatePrintMirror(); }; }(this));
+        }
+    }
     this.initializeUserCSSStyles();
     this.cursorWidth = this.cursor.clientWidth;
     this.cursorHeight = this.lineheight.clientHeight;
@@ -272,7 +304,7 @@ VT100.prototype.initializeElements = function(container) {
         this.addListener(window, 'resize', function(vt100) {
             return function() {
                 vt100.hideContextMenu();
-                vt100.resizer();
+                vt100.scheduleResize();
             };
         }(this));
         document.body.style.margin = '0px';
@@ -315,16 +347,62 @@ VT100.prototype.initializeElements = function(container) {
     this.addListener(this.scrollable, 'mousedown', mouseEvent(this, 0));
     this.addListener(this.scrollable, 'mouseup', mouseEvent(this, 1));
     this.addListener(this.scrollable, 'click', mouseEvent(this, 2));
-    this.currentScreen = 0;
-    this.cursorX = 0;
-    this.cursorY = 0;
+    if (this.canvas) {
+        this.addListener(this.scrollable, 'mousemove', mouseEvent(this, 3));
+    }
+    this.addListener(this.scrollable, 'scroll', function(vt100) {
+        return function() {
+            vt100.lastScrollTop = vt100.scrollable.scrollTop;
+            vt100.scrollPos = vt100.renderedScrollback - (vt100.lastScrollTop - 1) / vt100.cursorHeight;
+            if (vt100.scrollPos < 0) {
+                vt100.scrollPos = 0;
+            }
+            vt100.scheduleRender();
+        };
+    }(this));
+    this.initializeModel();
+    this.scrollbackSpacers = [document.createElement('div'), document.createElement('div')];
+    this.scrollbackSpacers[0].className = this.scrollbackSpacers[1].className = 'scrollback';
+    this.discardedNodes = [];
+    this.renderPending = false;
+    this.renderedScrollback = 0;
+    this.scrollPos = 0;
+    this.lastScrollTop = -1;
     this.numScrollbackLines = 0;
     this.top = 0;
     this.bottom = 0x7FFFFFFF;
+    this.resizeTimer = null;
     this.resizer();
     this.focusCursor();
     this.input.focus();
 };
+VT100.prototype.initializeModel = function() {
+    this.currentScreen = 0;
+    this.cursorX = 0;
+    this.cursorY = 0;
+    this.attrStyles = [];
+    this.trueColors = [];
+    this.trueColorIds = {};
+    this.blankLines = [];
+    this.lines = [[], []];
+    this.scrollback = [];
+    this.scrollbackStart = 0;
+    this.scrollbackLength = 0;
+    this.scrollbackTotal = 0;
+    this.scrollbackCache = {};
+    this.npar = 0;
+    this.par = new Int32Array(32);
+    this.isQuestionMark = false;
+    this.isDollar = false;
+    this.savedX = [];
+    this.savedY = [];
+    this.savedAttr = [];
+    this.savedUseGMap = 0;
+    this.savedGMap = [this.Latin1Map, this.VT100GraphicsMap, this.CodePage437Map, this.DirectToFontMap];
+    this.savedValid = [];
+    this.respondString = '';
+    this.statusString = '';
+};
 VT100.prototype.getChildById = function(parent, id) {
     var nodeList = parent.all || parent.getElementsByTagName('*');
     if (typeof nodeList.namedItem == 'undefined') {
@@ -353,28 +431,6 @@ VT100.prototype.showReconnect = function(state) {
         this.reconnectBtn.style.visibility = 'hidden';
     }
 };
-VT100.prototype.repairElements = function(console) {
-    for (var line = console.firstChild; line; line = line.nextSibling) {
-        if (!line.clientHeight) {
-            var newLine = document.createElement(line.tagName);
-            newLine.style.cssText = line.style.cssText;
-            newLine.className = line.className;
-            if (line.tagName == 'DIV') {
-                for (var span = line.firstChild; span; span = span.nextSibling) {
-                    var newSpan = document.createElement(span.tagName);
-                    newSpan.style.cssText = span.style.cssText;
-                    newSpan.style.className = span.style.className;
-                    this.setTextContent(newSpan, this.getTextContent(span));
-                    newLine.appendChild(newSpan);
-                }
-            } else {
-                this.setTextContent(newLine, this.getTextContent(line));
-            }
-            line.parentNode.replaceChild(newLine, line);
-            line = newLine;
-        }
-    }
-};
 VT100.prototype.resized = function(w, h) {
 };
 VT100.prototype.resizer = function() {
@@ -390,26 +446,53 @@ VT100.prototype.resizer = function() {
         this.cursor.parentNode.removeChild(this.cursor);
         this.cursor = newCursor;
     }
-    this.repairElements(this.console[0]);
-    this.repairElements(this.console[1]);
     this.cursor.style.width = this.cursorWidth + 'px';
     this.cursor.style.height = this.cursorHeight + 'px';
-    var console = this.console[this.currentScreen];
-    var height = (this.isEmbedded ? this.container.clientHeight : (window.innerHeight || document.documentElement.clientHeight || document.body.clientHeight)) - 1;
-    var partial = height % this.cursorHeight;
-    this.scrollable.style.height = (height > 0 ? height : 0) + 'px';
-    this.padding.style.height = (partial > 0 ? partial : 0) + 'px';
+    this.fitScrollable();
     var oldTerminalHeight = this.terminalHeight;
     this.updateWidth();
     this.updateHeight();
-    var cx = this.cursorX;
-    var cy = this.cursorY + this.numScrollbackLines;
-    this.updateNumScrollbackLines();
-    while (this.currentScreen && this.numScrollbackLines > 0) {
-        console.removeChild(console.firstChild);
-        this.numScrollbackLines--;
+    this.measureConsole();
+    if (this.worker) {
+        this.worker.postMessage({ resize: [this.terminalWidth, this.terminalHeight] });
+    } else {
+        this.resizeScreen(oldTerminalHeight);
+    }
+    this.scrollToBottom();
+    this.reconnectBtn.style.left = (this.terminalWidth * this.cursorWidth -
+        this.reconnectBtn.clientWidth) / 2 + 'px';
+    this.reconnectBtn.style.top = (this.terminalHeight * this.cursorHeight -
+        this.reconnectBtn.clientHeight) / 2 + 'px';
+    this.resized(this.terminalWidth, this.terminalHeight);
+};
+VT100.prototype.scheduleResize = function() {
+    if (this.resizeTimer) {
+        clearTimeout(this.resizeTimer);
     }
-    cy -= this.numScrollbackLines;
+    this.resizeTimer = setTimeout(function(vt100) {
+        return function() {
+            vt100.resizeTimer = null;
+            if (Math.floor(vt100.console[vt100.currentScreen].offsetWidth / vt100.cursorWidth) != vt100.terminalWidth ||
+                Math.floor((vt100.viewportHeight() - 1) / vt100.cursorHeight) != vt100.terminalHeight) {
+                vt100.resizer();
+            } else {
+                vt100.fitScrollable();
+            }
+        };
+    }(this), 150);
+};
+VT100.prototype.viewportHeight = function() {
+    return this.isEmbedded ? this.container.clientHeight : (window.innerHeight || document.documentElement.clientHeight || document.body.clientHeight);
+};
+VT100.prototype.fitScrollable = function() {
+    var height = this.viewportHeight() - 1;
+    var partial = height % this.cursorHeight;
+    this.scrollable.style.height = (height > 0 ? height : 0) + 'px';
+    this.padding.style.height = (partial > 0 ? partial : 0) + 'px';
+};
+VT100.prototype.resizeScreen = function(oldTerminalHeight) {
+    var cx = this.cursorX;
+    var cy = this.cursorY + this.resizeLines();
     if (cx < 0) {
         cx = 0;
     } else if (cx > this.terminalWidth) {
@@ -435,23 +518,7 @@ VT100.prototype.resizer = function() {
             this.top = 0;
         }
     }
-    this.truncateLines(this.terminalWidth);
     this.putString(cx, cy, '', undefined);
-    this.scrollable.scrollTop = this.numScrollbackLines * this.cursorHeight + 1;
-    var line = console.firstChild;
-    for (var i = 0; i < this.numScrollbackLines; i++) {
-        line.className = 'scrollback';
-        line = line.nextSibling;
-    }
-    while (line) {
-        line.className = '';
-        line = line.nextSibling;
-    }
-    this.reconnectBtn.style.left = (this.terminalWidth * this.cursorWidth -
-        this.reconnectBtn.clientWidth) / 2 + 'px';
-    this.reconnectBtn.style.top = (this.terminalHeight * this.cursorHeight -
-        this.reconnectBtn.clientHeight) / 2 + 'px';
-    this.resized(this.terminalWidth, this.terminalHeight);
 };
 VT100.prototype.showCurrentSize = function() {
     if (!this.indicateSize) {
@@ -474,6 +541,9 @@ VT100.prototype.showCurrentSize = function() {
     }(this), 1000);
 };
 VT100.prototype.selection = function() {
+    if (this.canvas && this.cellSelection) {
+        return this.selectedCellText();
+    }
     try {
         return '' + (window.getSelection && window.getSelection() || document.selection && document.selection.type == 'Text' && document.selection.createRange().text || '');
     } catch(e) {
@@ -496,6 +566,9 @@ VT100.prototype.cancelEvent = function(event) {
     return false;
 };
 VT100.prototype.mouseEvent = function(event, type) {
+    if (type == 3) {
+        return this.selectCells(event, type) ? this.cancelEvent(event) : true;
+    }
     var selection = this.selection();
     if ((type == 1 || type == 2) && !selection.length) {
         this.input.focus();
@@ -507,7 +580,7 @@ VT100.prototype.mouseEvent = function(event, type) {
         offsetY += e.offsetTop;
     }
     var x = (event.clientX - offsetX) / this.cursorWidth;
-    var y = ((event.clientY - offsetY) + this.scrollable.offsetTop) / this.cursorHeight - this.numScrollbackLines;
+    var y = (event.clientY - offsetY - this.scrollable.offsetTop + this.scrollable.scrollTop - this.consoleTop) / this.cursorHeight - this.numScrollbackLines;
     var inside = true;
     if (x >= this.terminalWidth) {
         x = this.terminalWidth - 1;
@@ -550,6 +623,9 @@ VT100.prototype.mouseEvent = function(event, type) {
             }
         }
     }
+    if (this.canvas && this.selectCells(event, type, button)) {
+        return this.cancelEvent(event);
+    }
     if (button == 2 && !event.shiftKey) {
         if (type == 0) {
             this.showContextMenu(event.clientX - offsetX, event.clientY - offsetY);
@@ -626,384 +702,849 @@ VT100.prototype.setTextContent = function(elem, s) {
         }
     }
 };
-VT100.prototype.insertBlankLine = function(y, color, style) {
-    if (!color) {
-        color = 'ansi0 bgAnsi15';
-    }
+VT100.prototype.getAttrStyle = function(attr) {
+    var style = this.attrStyles[attr];
     if (!style) {
-        style = '';
+        var bg = (attr >> 4) & 0xF;
+        var fg = attr & 0xF;
+        var bgExt = (attr >> 22) & 0x1FF;
+        var fgExt = (attr >> 13) & 0x1FF;
+        if (attr & 0x0100) {
+            var tmp = bg;
+            bg = fg;
+            fg = tmp;
+            tmp = bgExt;
+            bgExt = fgExt;
+            fgExt = tmp;
+        }
+        if ((attr & (0x0100 | 0x0400)) == 0x0400) {
+            fg = 8;
+        } else if (attr & 0x0800) {
+            fg |= 8;
+        }
+        if (attr & 0x1000) {
+            bg ^= 8;
+        }
+        if (!fgExt && !bgExt) {
+            if (bg == fg) {
+                if ((fg ^= 8) == 7) {
+                    fg = 8;
+                }
+            }
+            if (bg == 7 && fg >= 8) {
+                if ((fg -= 8) == 7) {
+                    fg = 8;
+                }
+            }
+        }
+        var fgColor = fgExt ? this.getExtendedColor(fgExt + 15) : null;
+        var bgColor = bgExt ? this.getExtendedColor(bgExt + 15) : null;
+        style = this.attrStyles[attr] = {
+            color: 'ansi' + fg + ' bgAnsi' + bg,
+            style: (attr & 0x0200 ? 'text-decoration:underline;' : '') +
+                (fgColor ? 'color:' + fgColor + ';' : '') +
+                (bgColor ? 'background-color:' + bgColor + ';' : ''),
+            fg: fgColor,
+            bg: bgColor,
+            underline: !!(attr & 0x0200),
+            blank: bg == 15 && !bgExt && !(attr & 0x0200)
+        };
     }
-    var line;
-    if (color != 'ansi0 bgAnsi15' && !style) {
-        line = document.createElement('pre');
-        this.setTextContent(line, '\n');
-    } else {
-        line = document.createElement('div');
-        var span = document.createElement('span');
-        span.style.cssText = style;
-        span.style.className = color;
-        this.setTextContent(span, this.spaces(this.terminalWidth));
-        line.appendChild(span);
+    return style;
+};
+VT100.prototype.getExtendedColor = function(color) {
+    return color < 256 ? this.xtermColors[color] : this.trueColors[color - 256];
+};
+VT100.prototype.getTrueColor = function(r, g, b) {
+    r = r < 0 ? 0 : r > 255 ? 255 : r;
+    g = g < 0 ? 0 : g > 255 ? 255 : g;
+    b = b < 0 ? 0 : b > 255 ? 255 : b;
+    var rgb = (r << 16) | (g << 8) | b;
+    var color = this.trueColorIds[rgb];
+    if (color == undefined) {
+        if (this.trueColors.length >= 271) {
+            return 16 + 36 * this.cubeLevel(r) + 6 * this.cubeLevel(g) + this.cubeLevel(b);
+        }
+        color = this.trueColorIds[rgb] = 256 + this.trueColors.length;
+        this.trueColors.push('#' + (0x1000000 | rgb).toString(16).substr(1));
     }
-    line.style.height = this.cursorHeight + 'px';
-    var console = this.console[this.currentScreen];
-    if (console.childNodes.length > y) {
-        console.insertBefore(line, console.childNodes[y]);
+    return color;
+};
+VT100.prototype.cubeLevel = function(x) {
+    return x < 48 ? 0 : x < 115 ? 1 : Math.floor((x - 35) / 40);
+};
+VT100.prototype.setColor = function(isBg, color) {
+    if (isBg) {
+        this.attr = (this.attr & ~0x7FC000F0) | (color < 16 ? color << 4 : (color - 15) << 22);
     } else {
-        console.appendChild(line);
+        this.attr = (this.attr & ~0x003FE00F) | (color < 16 ? color : (color - 15) << 13);
     }
 };
-VT100.prototype.updateWidth = function() {
-    this.terminalWidth = Math.floor(this.console[this.currentScreen].offsetWidth / this.cursorWidth);
-    return this.terminalWidth;
+VT100.prototype.createLine = function(width, attr) {
+    var line = { chars: new Uint32Array(width), attrs: new Uint32Array(width) };
+    this.clearLine(line, 0, width, attr);
+    return line;
 };
-VT100.prototype.updateHeight = function() {
-    if (this.isEmbedded) {
-        this.terminalHeight = Math.floor((this.container.clientHeight - 1) / this.cursorHeight);
-    } else {
-        this.terminalHeight = Math.floor(((window.innerHeight || document.documentElement.clientHeight || document.body.clientHeight) - 1) / this.cursorHeight);
+VT100.prototype.clearLine = function(line, x, w, attr) {
+    for (var i = x + w; i-- > x;) {
+        line.chars[i] = 0x20;
+        line.attrs[i] = attr;
     }
-    return this.terminalHeight;
 };
-VT100.prototype.updateNumScrollbackLines = function() {
-    var scrollback = Math.floor(this.console[this.currentScreen].offsetHeight / this.cursorHeight) -
-        this.terminalHeight;
-    this.numScrollbackLines = scrollback < 0 ? 0 : scrollback;
-    return this.numScrollbackLines;
-};
-VT100.prototype.truncateLines = function(width) {
-    if (width < 0) {
-        width = 0;
-    }
-    for (var line = this.console[this.currentScreen].firstChild; line; line = line.nextSibling) {
-        if (line.tagName == 'DIV') {
-            var x = 0;
-            for (var span = line.firstChild; span; span = span.nextSibling) {
-                var s = this.getTextContent(span);
-                var l = s.length;
-                if (x + l > width) {
-                    this.setTextContent(span, s.substr(0, width - x));
-                    while (span.nextSibling) {
-                        line.removeChild(line.lastChild);
-                    }
-                    break;
-                }
-                x += l;
-            }
-            var span = line.lastChild;
-            while (span && span.className == 'ansi0 bgAnsi15' && !span.style.cssText.length) {
-                var s = this.getTextContent(span);
-                for (var i = s.length; i--;) {
-                    if (s.charAt(i) != ' ' && s.charAt(i) != '\u00A0') {
-                        if (i + 1 != s.length) {
-                            this.setTextContent(s.substr(0, i + 1));
-                        }
-                        span = null;
-                        break;
-                    }
-                }
-                if (span) {
-                    var sibling = span;
-                    span = span.previousSibling;
-                    if (span) {
-                        line.removeChild(sibling);
-                    } else {
-                        var blank = document.createElement('pre');
-                        blank.style.height = this.cursorHeight + 'px';
-                        this.setTextContent(blank, '\n');
-                        line.parentNode.replaceChild(blank, line);
-                    }
-                }
-            }
+VT100.prototype.isBlankLine = function(line) {
+    for (var i = line.chars.length; i--;) {
+        if (line.chars[i] != 0x20 || !this.getAttrStyle(line.attrs[i]).blank) {
+            return false;
         }
     }
+    return true;
 };
-VT100.prototype.putString = function(x, y, text, color, style) {
-    if (!color) {
-        color = 'ansi0 bgAnsi15';
-    }
-    if (!style) {
-        style = '';
-    }
-    var yIdx = y + this.numScrollbackLines;
-    var line;
-    var sibling;
-    var s;
-    var span;
-    var xPos = 0;
-    var console = this.console[this.currentScreen];
-    if (!text.length && (yIdx >= console.childNodes.length || console.childNodes[yIdx].tagName != 'DIV')) {
-        span = null;
-    } else {
-        while (console.childNodes.length <= yIdx) {
-            this.insertBlankLine(yIdx);
-        }
-        line = console.childNodes[yIdx];
-        if (line.tagName != 'DIV') {
-            var div = document.createElement('div');
-            div.style.height = this.cursorHeight + 'px';
-            div.innerHTML = '<span></span>';
-            console.replaceChild(div, line);
-            line = div;
-        }
-        span = line.firstChild;
-        var len;
-        while (span.nextSibling && xPos < x) {
-            len = this.getTextContent(span).length;
-            if (xPos + len > x) {
-                break;
-            }
-            xPos += len;
-            span = span.nextSibling;
-        }
-        if (text.length) {
-            s = this.getTextContent(span);
-            var oldColor = span.className;
-            var oldStyle = span.style.cssText;
-            if (xPos + s.length < x) {
-                if (oldColor != 'ansi0 bgAnsi15' || oldStyle != '') {
-                    span = document.createElement('span');
-                    line.appendChild(span);
-                    span.className = 'ansi0 bgAnsi15';
-                    span.style.cssText = '';
-                    oldColor = 'ansi0 bgAnsi15';
-                    oldStyle = '';
-                    xPos += s.length;
-                    s = '';
-                }
-                do {
-                    s += ' ';
-                } while (xPos + s.length < x);
-            }
-            var del = text.length - s.length + x - xPos;
-            if (oldColor != color || (oldStyle != style && (oldStyle || style))) {
-                if (xPos == x) {
-                    if (text.length >= s.length) {
-                        s = text;
-                    } else {
-                        sibling = document.createElement('span');
-                        line.insertBefore(sibling, span);
-                        this.setTextContent(span, s.substr(text.length));
-                        span = sibling;
-                        s = text;
-                    }
-                } else {
-                    var remainder = s.substr(x + text.length - xPos);
-                    this.setTextContent(span, s.substr(0, x - xPos));
-                    xPos = x;
-                    sibling = document.createElement('span');
-                    if (span.nextSibling) {
-                        line.insertBefore(sibling, span.nextSibling);
-                        span = sibling;
-                        if (remainder.length) {
-                            sibling = document.createElement('span');
-                            sibling.className = oldColor;
-                            sibling.style.cssText = oldStyle;
-                            this.setTextContent(sibling, remainder);
-                            line.insertBefore(sibling, span.nextSibling);
-                        }
-                    } else {
-                        line.appendChild(sibling);
-                        span = sibling;
-                        if (remainder.length) {
-                            sibling = document.createElement('span');
-                            sibling.className = oldColor;
-                            sibling.style.cssText = oldStyle;
-                            this.setTextContent(sibling, remainder);
-                            line.appendChild(sibling);
-                        }
-                    }
-                    s = text;
-                }
-                span.className = color;
-                span.style.cssText = style;
-            } else {
-                s = s.substr(0, x - xPos) +
-                    text +
-                    s.substr(x + text.length - xPos);
-            }
-            this.setTextContent(span, s);
-            sibling = span.nextSibling;
-            while (del > 0 && sibling) {
-                s = this.getTextContent(sibling);
-                len = s.length;
-                if (len <= del) {
-                    line.removeChild(sibling);
-                    del -= len;
-                    sibling = span.nextSibling;
-                } else {
-                    this.setTextContent(sibling, s.substr(del));
-                    break;
-                }
-            }
-            if (sibling && span.className == sibling.className && span.style.cssText == sibling.style.cssText) {
-                this.setTextContent(span, this.getTextContent(span) +
-                    this.getTextContent(sibling));
-                line.removeChild(sibling);
-            }
+VT100.prototype.renderLine = function(line) {
+    var div = document.createElement('div');
+    div.style.height = this.cursorHeight + 'px';
+    var chars = line.chars;
+    var attrs = line.attrs;
+    var end = chars.length;
+    while (end > 0 && chars[end - 1] == 0x20 && this.getAttrStyle(attrs[end - 1]).blank) {
+        end--;
+    }
+    for (var x = 0; x < end;) {
+        var attr = attrs[x];
+        var start = x;
+        while (++x < end && attrs[x] == attr) {
         }
+        var style = this.getAttrStyle(attr);
+        var span = document.createElement('span');
+        span.className = style.color;
+        span.style.cssText = style.style;
+        this.setTextContent(span, this.codePointsToString(chars.subarray(start, x)));
+        div.appendChild(span);
     }
-    this.cursorX = x + text.length;
-    if (this.cursorX >= this.terminalWidth) {
-        this.cursorX = this.terminalWidth - 1;
-        if (this.cursorX < 0) {
-            this.cursorX = 0;
+    return div;
+};
+VT100.prototype.codePointsToString = function(chars) {
+    for (var i = chars.length; i--;) {
+        if (chars[i] > 0xFFFF) {
+            return String.fromCodePoint.apply(String, chars);
         }
     }
-    var pixelX = -1;
-    var pixelY = -1;
-    if (!this.cursor.style.visibility) {
-        var idx = this.cursorX - xPos;
-        if (span) {
-            pixelY = span.offsetTop +
-                span.offsetParent.offsetTop;
-            s = this.getTextContent(span);
-            var nxtIdx = idx - s.length;
-            if (nxtIdx < 0) {
-                this.setTextContent(this.cursor, s.charAt(idx));
-                pixelX = span.offsetLeft +
-                    idx * span.offsetWidth / s.length;
-            } else {
-                if (nxtIdx == 0) {
-                    pixelX = span.offsetLeft + span.offsetWidth;
-                }
-                if (span.nextSibling) {
-                    s = this.getTextContent(span.nextSibling);
-                    this.setTextContent(this.cursor, s.charAt(nxtIdx));
-                    if (pixelX < 0) {
-                        pixelX = span.nextSibling.offsetLeft +
-                            nxtIdx * span.offsetWidth / s.length;
-                    }
-                } else {
-                    this.setTextContent(this.cursor, ' ');
-                }
-            }
-        } else {
-            this.setTextContent(this.cursor, ' ');
-        }
+    return String.fromCharCode.apply(String, chars);
+};
+VT100.prototype.packLine = function(line) {
+    var end = line.chars.length;
+    while (end > 0 && line.chars[end - 1] == 0x20 && this.getAttrStyle(line.attrs[end - 1]).blank) {
+        end--;
     }
-    if (pixelX >= 0) {
-        this.cursor.style.left = (pixelX + (this.isIE ? 1 : 0)) + 'px';
-    } else {
-        this.setTextContent(this.space, this.spaces(this.cursorX));
-        this.cursor.style.left = this.space.offsetWidth +
-            console.offsetLeft + 'px';
+    var row = new Uint32Array(2 * end);
+    for (var i = 0; i < end; i++) {
+        row[2 * i] = line.chars[i];
+        row[2 * i + 1] = line.attrs[i];
     }
-    this.cursorY = yIdx - this.numScrollbackLines;
-    if (pixelY >= 0) {
-        this.cursor.style.top = pixelY + 'px';
+    return row;
+};
+VT100.prototype.unpackLine = function(row, width) {
+    var line = this.createLine(width, 0x00F0);
+    var end = row.length >> 1 < width ? row.length >> 1 : width;
+    for (var i = 0; i < end; i++) {
+        line.chars[i] = row[2 * i];
+        line.attrs[i] = row[2 * i + 1];
+    }
+    return line;
+};
+VT100.prototype.getScrollbackRow = function(i) {
+    return this.scrollback[(this.scrollbackStart + i) % this.maxScrollbackLines];
+};
+VT100.prototype.pushScrollback = function(line) {
+    if (this.scrollbackLength < this.maxScrollbackLines) {
+        this.scrollback[(this.scrollbackStart + this.scrollbackLength++) % this.maxScrollbackLines] = this.packLine(line);
     } else {
-        this.cursor.style.top = yIdx * this.cursorHeight +
-            console.offsetTop + 'px';
-    }
-    if (text.length) {
-        if ((sibling = span.previousSibling) && span.className == sibling.className && span.style.cssText == sibling.style.cssText) {
-            this.setTextContent(span, this.getTextContent(sibling) +
-                this.getTextContent(span));
-            line.removeChild(sibling);
-        }
-        span = line.lastChild;
-        while (span && span.className == 'ansi0 bgAnsi15' && !span.style.cssText.length) {
-            s = this.getTextContent(span);
-            for (var i = s.length; i--;) {
-                if (s.charAt(i) != ' ' && s.charAt(i) != '\u00A0') {
-                    if (i + 1 != s.length) {
-                        this.setTextContent(s.substr(0, i + 1));
-                    }
-                    span = null;
-                    break;
-                }
-            }
-            if (span) {
-                sibling = span;
-                span = span.previousSibling;
-                if (span) {
-                    line.removeChild(sibling);
-                } else {
-                    var blank = document.createElement('pre');
-                    blank.style.height = this.cursorHeight + 'px';
-                    this.setTextContent(blank, '\n');
-                    line.parentNode.replaceChild(blank, line);
-                }
-            }
-        }
+        this.scrollback[this.scrollbackStart] = this.packLine(line);
+        this.scrollbackStart = (this.scrollbackStart + 1) % this.maxScrollbackLines;
     }
+    this.scrollbackCache[this.scrollbackTotal++] = line;
 };
-VT100.prototype.gotoXY = function(x, y) {
-    if (x >= this.terminalWidth) {
-        x = this.terminalWidth - 1;
+VT100.prototype.popScrollback = function(width) {
+    var row = this.getScrollbackRow(--this.scrollbackLength);
+    this.scrollback[(this.scrollbackStart + this.scrollbackLength) % this.maxScrollbackLines] = undefined;
+    var line = this.scrollbackCache[--this.scrollbackTotal];
+    delete this.scrollbackCache[this.scrollbackTotal];
+    return line || this.unpackLine(row, width);
+};
+VT100.prototype.invalidateLine = function(y) {
+    this.lines[this.currentScreen][y].dirty = true;
+    this.scheduleRender();
+};
+VT100.prototype.discardLine = function(line) {
+    if (line.node) {
+        this.discardedNodes.push(line.node);
+        line.node = null;
     }
-    if (x < 0) {
-        x = 0;
+};
+VT100.prototype.setSynchronizedOutput = function(state) {
+    if (this.synchronizedTimer) {
+        clearTimeout(this.synchronizedTimer);
+        this.synchronizedTimer = null;
     }
-    var minY, maxY;
-    if (this.offsetMode) {
-        minY = this.top;
-        maxY = this.bottom;
-    } else {
-        minY = 0;
-        maxY = this.terminalHeight;
+    if (state) {
+        this.synchronizedTimer = setTimeout(function(vt100) { return function() { vt100.synchronizedTimer = null; vt100.setSynchronizedOutput(false); }; }(this), 1000);
+    } else if (this.synchronizedOutput) {
+        this.synchronizedOutput = false;
+        this.scheduleRender();
     }
-    if (y >= maxY) {
-        y = maxY - 1;
+    this.synchronizedOutput = state;
+};
+VT100.prototype.scheduleRender = function() {
+    if (!this.renderPending) {
+        this.renderPending = true;
+        var flush = function(vt100) { return function() { vt100.flush(); }; }(this);
+        if (typeof requestAnimationFrame != 'undefined') {
+            requestAnimationFrame(flush);
+        } else {
+            setTimeout(flush, 16);
+        }
     }
-    if (y < minY) {
-        y = minY;
+};
+VT100.prototype.placeLine = function(console, line, ref, className) {
+    var node = line.node;
+    if (!node || line.dirty) {
+        node = this.renderLine(line);
+        node.className = className;
+        line.dirty = false;
+        if (line.node == ref && ref) {
+            console.replaceChild(node, ref);
+            line.node = node;
+            return node.nextSibling;
+        }
+        if (line.node && line.node.parentNode) {
+            line.node.parentNode.removeChild(line.node);
+        }
+        line.node = node;
+    } else if (node.className != className) {
+        node.className = className;
     }
-    this.putString(x, y, '', undefined);
-    this.needWrap = false;
+    if (node == ref) {
+        return ref.nextSibling;
+    }
+    console.insertBefore(node, ref);
+    return ref;
 };
-VT100.prototype.gotoXaY = function(x, y) { this.gotoXY(x, this.offsetMode ? (this.top + y) : y); };
-VT100.prototype.refreshInvertedState = function() {
-    if (this.isInverted) {
-        this.scrollable.className += ' inverted';
-    } else {
-        this.scrollable.className = this.scrollable.className.replace(/ *inverted/, '');
+VT100.prototype.placeSpacer = function(console, node, ref, rows) {
+    var height = rows * this.cursorHeight + 'px';
+    if (node.style.height != height) {
+        node.style.height = height;
+    }
+    if (node == ref) {
+        return ref.nextSibling;
     }
+    console.insertBefore(node, ref);
+    return ref;
 };
-VT100.prototype.enableAlternateScreen = function(state) {
-    if ((state ? 1 : 0) == this.currentScreen) {
-        this.resizer();
+VT100.prototype.placeScrollback = function(console, ref) {
+    var first = this.scrollbackTotal - this.scrollbackLength;
+    var top = this.scrollbackTotal - Math.floor(this.scrollPos);
+    var start = top - 2 * this.terminalHeight;
+    var end = top + 2 * this.terminalHeight;
+    if (start < first) {
+        start = first;
+    }
+    if (end > this.scrollbackTotal) {
+        end = this.scrollbackTotal;
+    }
+    if (end < start) {
+        end = start;
+    }
+    var cache = {};
+    for (var i = start; i < end; i++) {
+        cache[i] = this.scrollbackCache[i] || this.unpackLine(this.getScrollbackRow(i - first), this.terminalWidth);
+    }
+    for (var i in this.scrollbackCache) {
+        if (!cache[i]) {
+            this.discardLine(this.scrollbackCache[i]);
+        }
+    }
+    this.scrollbackCache = cache;
+    for (var i = 0; i < this.discardedNodes.length; i++) {
+        var node = this.discardedNodes[i];
+        if (node == ref) {
+            ref = ref.nextSibling;
+        }
+        if (node.parentNode) {
+            node.parentNode.removeChild(node);
+        }
+    }
+    this.discardedNodes = [];
+    ref = this.placeSpacer(console, this.scrollbackSpacers[0], ref, start - first);
+    for (var i = start; i < end; i++) {
+        ref = this.placeLine(console, cache[i], ref, 'scrollback');
+    }
+    return this.placeSpacer(console, this.scrollbackSpacers[1], ref, this.scrollbackTotal - end);
+};
+VT100.prototype.flush = function() {
+    this.renderPending = false;
+    if (this.synchronizedOutput) {
         return;
     }
-    if (state) {
-        this.saveCursor();
+    for (var i = 0; i < this.discardedNodes.length; i++) {
+        var node = this.discardedNodes[i];
+        if (node.parentNode) {
+            node.parentNode.removeChild(node);
+        }
     }
-    this.currentScreen = state ? 1 : 0;
-    this.console[1 - this.currentScreen].style.display = 'none';
-    this.console[this.currentScreen].style.display = '';
-    this.resizer();
-    if (state) {
-        this.gotoXY(0, 0);
-        this.clearRegion(0, 0, this.terminalWidth, this.terminalHeight);
+    this.discardedNodes = [];
+    var console = this.console[this.currentScreen];
+    var lines = this.lines[this.currentScreen];
+    var ref = console.firstChild;
+    if (!this.currentScreen) {
+        ref = this.placeScrollback(console, ref);
+    }
+    if (this.canvas) {
+        this.paintCanvas();
     } else {
-        this.restoreCursor();
+        for (var i = 0; i < lines.length; i++) {
+            ref = this.placeLine(console, lines[i], ref, '');
+        }
     }
-};
-VT100.prototype.hideCursor = function() {
-    var hidden = this.cursor.style.visibility == 'hidden';
-    if (!hidden) {
-        this.cursor.style.visibility = 'hidden';
-        return true;
+    while (ref) {
+        var next = ref.nextSibling;
+        console.removeChild(ref);
+        ref = next;
+    }
+    this.positionCursor();
+    this.renderedScrollback = this.numScrollbackLines;
+    var scrollTop = (this.numScrollbackLines - this.scrollPos) * this.cursorHeight + 1;
+    if (scrollTop != this.lastScrollTop) {
+        this.scrollable.scrollTop = this.lastScrollTop = scrollTop;
     }
-    return false;
 };
-VT100.prototype.showCursor = function(x, y) {
-    if (this.cursor.style.visibility) {
-        this.cursor.style.visibility = '';
-        this.putString(x == undefined ? this.cursorX : x, y == undefined ? this.cursorY : y, '', undefined);
-        return true;
+VT100.prototype.startWorker = function() {
+    var scripts = document.getElementsByTagName('script');
+    for (var i = 0; i < scripts.length; i++) {
+        if (/ShellInABox\.js([?#].*)?$/.test(scripts[i].src)) {
+            try {
+                this.worker = new Worker(scripts[i].src);
+            } catch(e) {
+                return;
+            }
+            this.workerLines = {};
+            this.worker.onmessage = function(vt100) {
+                return function(e) {
+                    vt100.onWorkerMessage(e.data);
+                };
+            }(this);
+            this.worker.onerror = function(vt100) {
+                return function(e) {
+                    vt100.workerFailed();
+                };
+            }(this);
+            this.worker.postMessage({ init: [this.terminalWidth, this.terminalHeight, this.utfEnabled, this.maxScrollbackLines] });
+            return;
+        }
     }
-    return false;
 };
-VT100.prototype.scrollBack = function() {
-    var i = this.scrollable.scrollTop -
-        this.scrollable.clientHeight;
-    this.scrollable.scrollTop = i < 0 ? 0 : i;
+VT100.prototype.workerFailed = function() {
+    this.worker = null;
+    this.workerLines = {};
+    this.reset(true);
+    this.scheduleRender();
 };
-VT100.prototype.scrollFore = function() {
-    var i = this.scrollable.scrollTop +
-        this.scrollable.clientHeight;
+VT100.prototype.postToWorker = function(data, decoded, consumed) {
+    if (typeof data == 'string') {
+        this.worker.postMessage({ data: data, decoded: !!decoded, consumed: consumed || 0 });
+    } else {
+        var bytes = new Uint8Array(data);
+        this.worker.postMessage({ bytes: bytes.buffer, consumed: consumed || 0 }, [bytes.buffer]);
+    }
+};
+VT100.prototype.onWorkerMessage = function(msg) {
+    if (msg.respond) {
+        this.respond(msg.respond);
+    }
+    if (msg.rows) {
+        this.applyWorkerBatch(msg);
+    }
+};
+VT100.prototype.respond = function(s) {
+};
+VT100.prototype.applyWorkerBatch = function(batch) {
+    var state = batch.state;
+    if (state.clear) {
+        this.trueColors = [];
+        this.trueColorIds = {};
+        this.attrStyles = [];
+        if (this.canvas) {
+            this.resetGlyphs();
+        }
+        for (var id in this.workerLines) {
+            this.discardLine(this.workerLines[id]);
+        }
+        for (var i in this.scrollbackCache) {
+            this.discardLine(this.scrollbackCache[i]);
+        }
+        this.workerLines = {};
+        this.scrollback = [];
+        this.scrollbackStart = 0;
+        this.scrollbackLength = 0;
+        this.scrollbackTotal = 0;
+        this.scrollbackCache = {};
+    }
+    for (var i = 0; i < state.trueColors.length; i++) {
+        this.trueColors.push(state.trueColors[i]);
+    }
+    var rows = new Uint32Array(batch.rows);
+    for (var i = 0; i < rows.length;) {
+        var id = rows[i++];
+        var width = rows[i++];
+        var line = this.workerLines[id];
+        if (!line || line.chars.length != width) {
+            if (line) {
+                this.discardLine(line);
+            }
+            line = this.workerLines[id] = { chars: new Uint32Array(width), attrs: new Uint32Array(width) };
+        }
+        line.chars.set(rows.subarray(i, i + width));
+        line.attrs.set(rows.subarray(i + width, i + 2 * width));
+        line.dirty = true;
+        i += 2 * width;
+    }
+    var pushed = {};
+    var ops = new Int32Array(batch.scrollback);
+    for (var i = 0; i < ops.length; i++) {
+        if (ops[i] < 0) {
+            this.discardLine(this.popScrollback(this.terminalWidth));
+        } else {
+            this.pushScrollback(this.workerLines[ops[i]]);
+            pushed[ops[i]] = true;
+            delete this.workerLines[ops[i]];
+        }
+    }
+    var workerLines = {};
+    for (var s = 0; s < 2; s++) {
+        var ids = new Int32Array(batch.screens[s]);
+        var lines = [];
+        for (var i = 0; i < ids.length; i++) {
+            lines[i] = workerLines[ids[i]] = this.workerLines[ids[i]];
+        }
+        var old = this.lines[s];
+        for (var i = 0; i < old.length; i++) {
+            var id = old[i].id;
+            if (id == undefined || !workerLines[id] && !pushed[id]) {
+                this.discardLine(old[i]);
+            }
+        }
+        this.lines[s] = lines;
+    }
+    for (var id in workerLines) {
+        workerLines[id].id = +id;
+    }
+    this.workerLines = workerLines;
+    if (state.currentScreen != this.currentScreen) {
+        this.currentScreen = state.currentScreen;
+        this.console[1 - this.currentScreen].style.display = 'none';
+        this.console[this.currentScreen].style.display = '';
+        this.measureConsole();
+    }
+    this.cursorX = state.cursorX;
+    this.cursorY = state.cursorY;
+    this.cursor.style.visibility = state.cursorHidden ? 'hidden' : '';
+    if (state.isInverted != this.isInverted) {
+        this.isInverted = state.isInverted;
+        this.refreshInvertedState();
+    }
+    this.cursorKeyMode = state.cursorKeyMode;
+    this.applKeyMode = state.applKeyMode;
+    this.crLfMode = state.crLfMode;
+    this.mouseReporting = state.mouseReporting;
+    this.utfEnabled = state.utfEnabled;
+    if (state.flash) {
+        this.flashScreen();
+    }
+    if (state.bell) {
+        this.beep();
+    }
+    if (state.print) {
+        this.csii(0);
+    }
+    this.numScrollbackLines = this.currentScreen ? 0 : this.scrollbackLength;
+    this.scheduleRender();
+};
+VT100.prototype.paintCanvas = function() {
+    var lines = this.lines[this.currentScreen];
+    var ratio = window.devicePixelRatio || 1;
+    var width = this.terminalWidth * this.cursorWidth;
+    var height = lines.length * this.cursorHeight;
+    if (this.canvas.width != Math.round(width * ratio) || this.canvas.height != Math.round(height * ratio) || this.canvasScreen != this.currentScreen) {
+        this.canvas.width = Math.round(width * ratio);
+        this.canvas.height = Math.round(height * ratio);
+        this.canvas.style.width = width + 'px';
+        this.canvas.style.height = height + 'px';
+        this.canvasContext.setTransform(ratio, 0, 0, ratio, 0, 0);
+        this.canvasScreen = this.currentScreen;
+        this.canvasRows = [];
+    }
+    if (this.glyphRatio != ratio) {
+        this.resetGlyphs();
+        this.glyphRatio = ratio;
+    }
+    for (var y = 0; y < lines.length; y++) {
+        var line = lines[y];
+        if (this.canvasRows[y] != line || line.dirty) {
+            this.paintRow(line, y);
+            this.canvasRows[y] = line;
+            line.dirty = false;
+            line.node = null;
+        }
+    }
+    this.canvasRows.length = lines.length;
+};
+VT100.prototype.paintRow = function(line, y) {
+    var context = this.canvasContext;
+    var top = y * this.cursorHeight;
+    context.clearRect(0, top, line.chars.length * this.cursorWidth, this.cursorHeight);
+    for (var x = 0; x < line.chars.length; x++) {
+        var attr = line.attrs[x];
+        if (this.isCellSelected(x, y)) {
+            attr ^= 0x0100;
+        }
+        var style = this.getAttrStyle(attr);
+        if (line.chars[x] != 0x20 || !style.blank) {
+            var glyph = this.getGlyph(line.chars[x], style);
+            context.drawImage(glyph.page, glyph.x, glyph.y, glyph.width, glyph.height, x * this.cursorWidth, top, this.cursorWidth, this.cursorHeight);
+        }
+    }
+};
+VT100.prototype.resetGlyphs = function() {
+    this.glyphs = {};
+    this.glyphColors = {};
+    this.glyphCount = 0;
+    this.canvasRows = [];
+};
+VT100.prototype.getGlyphColors = function(className) {
+    var key = className + this.glyphVariant;
+    var colors = this.glyphColors[key];
+    if (!colors) {
+        var probe = document.createElement('span');
+        probe.className = className;
+        this.lineheight.appendChild(probe);
+        var bg = this.getCurrentComputedStyle(probe, 'backgroundColor');
+        colors = this.glyphColors[key] = {
+            fg: this.getCurrentComputedStyle(probe, 'color'),
+            bg: !bg || bg == 'transparent' || bg == 'rgba(0, 0, 0, 0)' ? null : bg
+        };
+        this.lineheight.removeChild(probe);
+    }
+    return colors;
+};
+VT100.prototype.getGlyph = function(code, style) {
+    var key = style.color + this.glyphVariant + ' ' + style.style + ' ' + code;
+    var glyph = this.glyphs[key];
+    if (!glyph) {
+        var ratio = this.glyphRatio;
+        var width = Math.ceil(this.cursorWidth * ratio);
+        var height = Math.ceil(this.cursorHeight * ratio);
+        var n = this.glyphCount++;
+        var page = this.glyphPages[n >> 10];
+        if (!page) {
+            page = this.glyphPages[n >> 10] = document.createElement('canvas');
+            page.width = 32 * width;
+            page.height = 32 * height;
+        }
+        glyph = this.glyphs[key] = { page: page, x: (n & 31) * width, y: ((n >> 5) & 31) * height, width: width, height: height };
+        var colors = this.getGlyphColors(style.color);
+        var context = page.getContext('2d');
+        context.clearRect(glyph.x, glyph.y, width, height);
+        if (style.bg || colors.bg) {
+            context.fillStyle = style.bg || colors.bg;
+            context.fillRect(glyph.x, glyph.y, width, height);
+        }
+        context.save();
+        context.beginPath();
+        context.rect(glyph.x, glyph.y, width, height);
+        context.clip();
+        context.font = parseFloat(this.getCurrentComputedStyle(this.console[0], 'fontSize')) * ratio + 'px ' + this.getCurrentComputedStyle(this.console[0], 'fontFamily');
+        context.textBaseline = 'middle';
+        context.fillStyle = style.fg || colors.fg;
+        context.fillText(String.fromCodePoint(code), glyph.x, glyph.y + height / 2);
+        if (style.underline) {
+            context.fillRect(glyph.x, glyph.y + height - 2 * ratio, width, Math.ceil(ratio));
+        }
+        context.restore();
+    }
+    return glyph;
+};
+VT100.prototype.isCellSelected = function(x, y) {
+    var s = this.cellSelection;
+    return s != null && (y > s.startY || y == s.startY && x >= s.startX) && (y < s.endY || y == s.endY && x < s.endX);
+};
+VT100.prototype.setCellSelection = function(selection) {
+    var old = this.cellSelection;
+    for (var i = 0; i < 2; i++) {
+        var s = i ? selection : old;
+        if (s) {
+            for (var y = s.startY; y <= s.endY; y++) {
+                this.canvasRows[y] = null;
+            }
+        }
+    }
+    this.cellSelection = selection;
+    this.scheduleRender();
+};
+VT100.prototype.selectCells = function(event, type, button) {
+    var rect = this.canvas.getBoundingClientRect();
+    var x = Math.floor((event.clientX - rect.left) / this.cursorWidth);
+    var y = Math.floor((event.clientY - rect.top) / this.cursorHeight);
+    if (x < 0) {
+        x = 0;
+    } else if (x > this.terminalWidth) {
+        x = this.terminalWidth;
+    }
+    if (y >= this.terminalHeight) {
+        y = this.terminalHeight - 1;
+    }
+    if (type == 0) {
+        if (this.cellSelection) {
+            this.setCellSelection(null);
+        }
+        if (button != 0 || y < 0) {
+            return false;
+        }
+        this.selectAnchor = { x: x, y: y };
+        return true;
+    }
+    if (!this.selectAnchor) {
+        return false;
+    }
+    if (y < 0) {
+        y = 0;
+        x = 0;
+    }
+    var a = this.selectAnchor;
+    if (type == 1) {
+        this.selectAnchor = null;
+    }
+    if (a.y == y && a.x == x) {
+        if (this.cellSelection) {
+            this.setCellSelection(null);
+        }
+    } else if (a.y < y || a.y == y && a.x < x) {
+        this.setCellSelection({ startX: a.x, startY: a.y, endX: x, endY: y });
+    } else {
+        this.setCellSelection({ startX: x, startY: y, endX: a.x, endY: a.y });
+    }
+    return type == 3;
+};
+VT100.prototype.selectedCellText = function() {
+    var s = this.cellSelection;
+    var lines = this.lines[this.currentScreen];
+    var text = '';
+    for (var y = s.startY; y <= s.endY && y < lines.length; y++) {
+        var chars = lines[y].chars;
+        var end = y == s.endY ? s.endX : chars.length;
+        var row = this.codePointsToString(chars.subarray(y == s.startY ? s.startX : 0, end));
+        text += y < s.endY ? row.replace(/ +$/, '') + '\n' : row;
+    }
+    return text;
+};
+VT100.prototype.updatePrintMirror = function() {
+    var lines = this.lines[this.currentScreen];
+    this.printMirror.innerHTML = '';
+    for (var i = 0; i < lines.length; i++) {
+        this.printMirror.appendChild(this.renderLine(lines[i]));
+    }
+};
+VT100.prototype.updateWidth = function() {
+    this.terminalWidth = Math.floor(this.console[this.currentScreen].offsetWidth / this.cursorWidth);
+    return this.terminalWidth;
+};
+VT100.prototype.updateHeight = function() {
+    this.terminalHeight = Math.floor((this.viewportHeight() - 1) / this.cursorHeight);
+    return this.terminalHeight;
+};
+VT100.prototype.resizeLines = function() {
+    var lines = this.lines[this.currentScreen];
+    var width = this.terminalWidth > 0 ? this.terminalWidth : 0;
+    var height = this.terminalHeight > 0 ? this.terminalHeight : 0;
+    var shift = 0;
+    var used = lines.length;
+    while (used > this.cursorY + 1 && this.isBlankLine(lines[used - 1])) {
+        used--;
+    }
+    if (used > height) {
+        shift = height - used;
+        for (var i = shift; i++ < 0;) {
+            if (this.currentScreen) {
+                this.discardLine(lines.shift());
+            } else {
+                this.pushScrollback(lines.shift());
+            }
+        }
+    } else if (!this.currentScreen && lines.length < height && this.scrollbackLength) {
+        shift = height - lines.length;
+        if (shift > this.scrollbackLength) {
+            shift = this.scrollbackLength;
+        }
+        for (var i = 0; i < shift; i++) {
+            lines.unshift(this.popScrollback(width));
+        }
+    }
+    while (lines.length > height) {
+        this.discardLine(lines.pop());
+    }
+    while (lines.length < height) {
+        lines.push(this.createLine(width, 0x00F0));
+    }
+    for (var i = 0; i < height; i++) {
+        var line = lines[i];
+        if (line.chars.length != width) {
+            lines[i] = this.createLine(width, 0x00F0);
+            var w = line.chars.length < width ? line.chars.length : width;
+            lines[i].chars.set(line.chars.subarray(0, w));
+            lines[i].attrs.set(line.attrs.subarray(0, w));
+            this.discardLine(line);
+        }
+    }
+    this.numScrollbackLines = this.currentScreen ? 0 : this.scrollbackLength;
+    this.scheduleRender();
+    return shift;
+};
+VT100.prototype.putString = function(x, y, text, attr) {
+    if (attr == undefined) {
+        attr = 0x00F0;
+    }
+    var line = this.lines[this.currentScreen][y];
+    var len = text.length;
+    if (len && line) {
+        for (var i = 0, n = x; i < text.length; n++) {
+            var ch = text.charCodeAt(i++);
+            if (ch >= 0xD800 && ch < 0xDC00 && i < text.length) {
+                ch = ((ch - 0xD800) << 10) + text.charCodeAt(i++) - 0xDC00 + 0x10000;
+                len--;
+            }
+            if (n < line.chars.length) {
+                line.chars[n] = ch;
+                line.attrs[n] = attr;
+            }
+        }
+        this.invalidateLine(y);
+    }
+    this.cursorX = x + len;
+    if (this.cursorX >= this.terminalWidth) {
+        this.cursorX = this.terminalWidth - 1;
+        if (this.cursorX < 0) {
+            this.cursorX = 0;
+        }
+    }
+    this.cursorY = y;
+    this.scheduleRender();
+};
+VT100.prototype.positionCursor = function() {
+    if (!this.cursor.style.visibility) {
+        var line = this.lines[this.currentScreen][this.cursorY];
+        this.setTextContent(this.cursor, line && this.cursorX < line.chars.length ? String.fromCodePoint(line.chars[this.cursorX]) : ' ');
+    }
+    var left = Math.round(this.cursorX * this.charWidth) + this.consoleLeft + 'px';
+    var top = (this.cursorY + this.numScrollbackLines) * this.cursorHeight + this.consoleTop + 'px';
+    if (this.cursor.style.left != left) {
+        this.cursor.style.left = left;
+    }
+    if (this.cursor.style.top != top) {
+        this.cursor.style.top = top;
+    }
+};
+VT100.prototype.measureConsole = function() {
+    var console = this.console[this.currentScreen];
+    this.consoleLeft = (this.canvas || console).offsetLeft;
+    this.consoleTop = console.offsetTop;
+    if (this.canvas) {
+        this.charWidth = this.cursorWidth;
+    } else {
+        this.setTextContent(this.space, this.spaces(100));
+        this.charWidth = this.space.offsetWidth / 100;
+    }
+};
+VT100.prototype.gotoXY = function(x, y) {
+    if (x >= this.terminalWidth) {
+        x = this.terminalWidth - 1;
+    }
+    if (x < 0) {
+        x = 0;
+    }
+    var minY, maxY;
+    if (this.offsetMode) {
+        minY = this.top;
+        maxY = this.bottom;
+    } else {
+        minY = 0;
+        maxY = this.terminalHeight;
+    }
+    if (y >= maxY) {
+        y = maxY - 1;
+    }
+    if (y < minY) {
+        y = minY;
+    }
+    this.putString(x, y, '', undefined);
+    this.needWrap = false;
+};
+VT100.prototype.gotoXaY = function(x, y) { this.gotoXY(x, this.offsetMode ? (this.top + y) : y); };
+VT100.prototype.refreshInvertedState = function() {
+    if (this.isInverted) {
+        this.scrollable.className += ' inverted';
+    } else {
+        this.scrollable.className = this.scrollable.className.replace(/ *inverted/, '');
+    }
+    if (this.canvas) {
+        this.glyphVariant = this.isInverted ? ' inverted' : '';
+        this.canvasRows = [];
+        this.scheduleRender();
+    }
+};
+VT100.prototype.enableAlternateScreen = function(state) {
+    if ((state ? 1 : 0) == this.currentScreen) {
+        this.resizer();
+        return;
+    }
+    if (state) {
+        this.saveCursor();
+    }
+    this.currentScreen = state ? 1 : 0;
+    this.console[1 - this.currentScreen].style.display = 'none';
+    this.console[this.currentScreen].style.display = '';
+    this.resizer();
+    if (state) {
+        this.gotoXY(0, 0);
+        this.clearRegion(0, 0, this.terminalWidth, this.terminalHeight);
+    } else {
+        this.restoreCursor();
+    }
+};
+VT100.prototype.hideCursor = function() {
+    var hidden = this.cursor.style.visibility == 'hidden';
+    if (!hidden) {
+        this.cursor.style.visibility = 'hidden';
+        return true;
+    }
+    return false;
+};
+VT100.prototype.showCursor = function(x, y) {
+    if (this.cursor.style.visibility) {
+        this.cursor.style.visibility = '';
+        this.putString(x == undefined ? this.cursorX : x, y == undefined ? this.cursorY : y, '', undefined);
+        return true;
+    }
+    return false;
+};
+VT100.prototype.scrollToBottom = function() {
+    this.scrollPos = 0;
+    this.scheduleRender();
+};
+VT100.prototype.scrollBack = function() {
+    var i = this.scrollable.scrollTop -
+        this.scrollable.clientHeight;
+    this.scrollable.scrollTop = i < 0 ? 0 : i;
+};
+VT100.prototype.scrollFore = function() {
+    var i = this.scrollable.scrollTop +
+        this.scrollable.clientHeight;
     this.scrollable.scrollTop = i > this.numScrollbackLines * this.cursorHeight + 1 ? this.numScrollbackLines * this.cursorHeight + 1 : i;
 };
 VT100.prototype.spaces = function(i) {
@@ -1013,7 +1554,14 @@ VT100.prototype.spaces = function(i) {
     }
     return s;
 };
-VT100.prototype.clearRegion = function(x, y, w, h, color, style) {
+VT100.prototype.getBlankLine = function(attr, width) {
+    var blank = this.blankLines[attr];
+    if (!blank || blank.chars.length < width) {
+        blank = this.blankLines[attr] = this.createLine(width > this.terminalWidth ? width : this.terminalWidth, attr);
+    }
+    return blank;
+};
+VT100.prototype.clearRegion = function(x, y, w, h, attr) {
     w += x;
     if (x < 0) {
         x = 0;
@@ -1034,75 +1582,24 @@ VT100.prototype.clearRegion = function(x, y, w, h, color, style) {
     if ((h -= y) <= 0) {
         return;
     }
-    if (!this.numScrollbackLines && w == this.terminalWidth && h == this.terminalHeight && (color == undefined || color == 'ansi0 bgAnsi15') && !style) {
-        var console = this.console[this.currentScreen];
-        while (console.lastChild) {
-            console.removeChild(console.lastChild);
-        }
-        this.putString(this.cursorX, this.cursorY, '', undefined);
-    } else {
-        var hidden = this.hideCursor();
-        var cx = this.cursorX;
-        var cy = this.cursorY;
-        var s = this.spaces(w);
-        for (var i = y + h; i-- > y;) {
-            this.putString(x, i, s, color, style);
-        }
-        hidden ? this.showCursor(cx, cy) : this.putString(cx, cy, '', undefined);
+    if (attr == undefined) {
+        attr = 0x00F0;
+    }
+    var blank = this.getBlankLine(attr, x + w);
+    var lines = this.lines[this.currentScreen];
+    for (var i = y; i < y + h; i++) {
+        lines[i].chars.set(blank.chars.subarray(x, x + w), x);
+        lines[i].attrs.set(blank.attrs.subarray(x, x + w), x);
+        this.invalidateLine(i);
     }
 };
 VT100.prototype.copyLineSegment = function(dX, dY, sX, sY, w) {
-    var text = [];
-    var className = [];
-    var style = [];
-    var console = this.console[this.currentScreen];
-    if (sY >= console.childNodes.length) {
-        text[0] = this.spaces(w);
-        className[0] = undefined;
-        style[0] = undefined;
-    } else {
-        var line = console.childNodes[sY];
-        if (line.tagName != 'DIV' || !line.childNodes.length) {
-            text[0] = this.spaces(w);
-            className[0] = undefined;
-            style[0] = undefined;
-        } else {
-            var x = 0;
-            for (var span = line.firstChild; span && w > 0; span = span.nextSibling) {
-                var s = this.getTextContent(span);
-                var len = s.length;
-                if (x + len > sX) {
-                    var o = sX > x ? sX - x : 0;
-                    text[text.length] = s.substr(o, w);
-                    className[className.length] = span.className;
-                    style[style.length] = span.style.cssText;
-                    w -= len - o;
-                }
-                x += len;
-            }
-            if (w > 0) {
-                text[text.length] = this.spaces(w);
-                className[className.length] = undefined;
-                style[style.length] = undefined;
-            }
-        }
-    }
-    var hidden = this.hideCursor();
-    var cx = this.cursorX;
-    var cy = this.cursorY;
-    for (var i = 0; i < text.length; i++) {
-        var color;
-        if (className[i]) {
-            color = className[i];
-        } else {
-            color = 'ansi0 bgAnsi15';
-        }
-        this.putString(dX, dY - this.numScrollbackLines, text[i], color, style[i]);
-        dX += text[i].length;
-    }
-    hidden ? this.showCursor(cx, cy) : this.putString(cx, cy, '', undefined);
+    var lines = this.lines[this.currentScreen];
+    lines[dY].chars.set(lines[sY].chars.subarray(sX, sX + w), dX);
+    lines[dY].attrs.set(lines[sY].attrs.subarray(sX, sX + w), dX);
+    this.invalidateLine(dY);
 };
-VT100.prototype.scrollRegion = function(x, y, w, h, incX, incY, color, style) {
+VT100.prototype.scrollRegion = function(x, y, w, h, incX, incY, attr) {
     var left = incX < 0 ? -incX : 0;
     var right = incX > 0 ? incX : 0;
     var up = incY < 0 ? -incY : 0;
@@ -1129,72 +1626,56 @@ VT100.prototype.scrollRegion = function(x, y, w, h, incX, incY, color, style) {
         dontScroll = 1;
     }
     if (!dontScroll) {
-        if (style && style.indexOf('underline')) {
-            style = style.replace(/text-decoration:underline;/, '');
-        }
-        var scrollPos = this.numScrollbackLines -
-            (this.scrollable.scrollTop - 1) / this.cursorHeight;
+        attr = (attr == undefined ? 0x00F0 : attr) & ~0x0200;
         var hidden = this.hideCursor();
         var cx = this.cursorX;
         var cy = this.cursorY;
-        var console = this.console[this.currentScreen];
+        var lines = this.lines[this.currentScreen];
         if (!incX && !x && w == this.terminalWidth) {
             if (incY < 0) {
                 if (!this.currentScreen && y == -incY && h == this.terminalHeight + incY) {
-                    while (console.childNodes.length < this.terminalHeight) {
-                        this.insertBlankLine(this.terminalHeight);
-                    }
                     for (var i = 0; i < y; i++) {
-                        this.insertBlankLine(console.childNodes.length, color, style);
-                    }
-                    this.updateNumScrollbackLines();
-                    while (this.numScrollbackLines > (this.currentScreen ? 0 : this.maxScrollbackLines)) {
-                        console.removeChild(console.firstChild);
-                        this.numScrollbackLines--;
-                    }
-                    for (var i = this.numScrollbackLines, j = -incY; i-- > 0 && j-- > 0;) {
-                        console.childNodes[i].className = 'scrollback';
+                        this.pushScrollback(lines.shift());
+                        lines.push(this.createLine(this.terminalWidth, attr));
                     }
+                    this.numScrollbackLines = this.scrollbackLength;
                 } else {
-                    for (var i = -incY; i-- > 0 && console.childNodes.length > this.numScrollbackLines + y + incY;) {
-                        console.removeChild(console.childNodes[this.numScrollbackLines + y + incY]);
+                    for (var i = -incY; i-- > 0;) {
+                        this.discardLine(lines.splice(y + incY, 1)[0]);
                     }
-                    if (this.numScrollbackLines > 0 || console.childNodes.length > this.numScrollbackLines + y + h + incY) {
-                        for (var i = -incY; i-- > 0;) {
-                            this.insertBlankLine(this.numScrollbackLines + y + h + incY, color, style);
-                        }
+                    for (var i = -incY; i-- > 0;) {
+                        lines.splice(y + h + incY, 0, this.createLine(this.terminalWidth, attr));
                     }
                 }
             } else {
-                for (var i = incY; i-- > 0 && console.childNodes.length > this.numScrollbackLines + y + h;) {
-                    console.removeChild(console.childNodes[this.numScrollbackLines + y + h]);
+                for (var i = incY; i-- > 0;) {
+                    this.discardLine(lines.splice(y + h, 1)[0]);
                 }
-                for (var i = incY; i--;) {
-                    this.insertBlankLine(this.numScrollbackLines + y, color, style);
+                for (var i = incY; i-- > 0;) {
+                    lines.splice(y, 0, this.createLine(this.terminalWidth, attr));
                 }
             }
         } else {
             if (incY <= 0) {
-                for (var i = y + this.numScrollbackLines; i < y + this.numScrollbackLines + h; i++) {
+                for (var i = y; i < y + h; i++) {
                     this.copyLineSegment(x + incX, i + incY, x, i, w);
                 }
             } else {
-                for (var i = y + this.numScrollbackLines + h; i-- > y + this.numScrollbackLines;) {
+                for (var i = y + h; i-- > y;) {
                     this.copyLineSegment(x + incX, i + incY, x, i, w);
                 }
             }
             if (incX > 0) {
-                this.clearRegion(x, y, incX, h, color, style);
+                this.clearRegion(x, y, incX, h, attr);
             } else if (incX < 0) {
-                this.clearRegion(x + w + incX, y, -incX, h, color, style);
+                this.clearRegion(x + w + incX, y, -incX, h, attr);
             }
             if (incY > 0) {
-                this.clearRegion(x, y, w, incY, color, style);
+                this.clearRegion(x, y, w, incY, attr);
             } else if (incY < 0) {
-                this.clearRegion(x, y + h + incY, w, -incY, color, style);
+                this.clearRegion(x, y + h + incY, w, -incY, attr);
             }
         }
-        this.scrollable.scrollTop = (this.numScrollbackLines - scrollPos) * this.cursorHeight + 1;
         hidden ? this.showCursor(cx, cy) : this.putString(cx, cy, '', undefined);
     }
 };
@@ -1237,6 +1718,9 @@ VT100.prototype.pasteFnc = function() {
 VT100.prototype.toggleUTF = function() {
     this.utfEnabled = !this.utfEnabled;
     this.utfPreferred = this.utfEnabled;
+    if (this.worker) {
+        this.worker.postMessage({ utf: this.utfEnabled });
+    }
 };
 VT100.prototype.toggleBell = function() { this.visualBell = !this.visualBell; };
 VT100.prototype.about = function() { alert("VT100 Terminal Emulator " + "2.10 (revision 186)" + "\nCopyright 2008-2009 by Markus Gutschke\n" + "For more information check http://shellinabox.com"); };
@@ -1368,7 +1852,7 @@ VT100.prototype.handleKey = function(event) {
     }
     ch = this.applyModifiers(ch, event);
     if (ch != undefined) {
-        this.scrollable.scrollTop = this.numScrollbackLines * this.cursorHeight + 1;
+        this.scrollToBottom();
     } else {
         if ((event.altKey || event.metaKey) && !event.shiftKey && !event.ctrlKey) {
             switch (key) {
@@ -1592,7 +2076,7 @@ VT100.prototype.handleKey = function(event) {
             default:
                 return;
             }
-            this.scrollable.scrollTop = this.numScrollbackLines * this.cursorHeight + 1;
+            this.scrollToBottom();
         }
     }
     if (event.shiftKey || event.ctrlKey || event.altKey || event.metaKey) {
@@ -2039,12 +2523,29 @@ VT100.prototype.lf = function(count) {
             count = 1;
         }
     }
-    while (count-- > 0) {
+    this.lineFeed(count);
+};
+VT100.prototype.lineFeed = function(count) {
+    while (count > 0) {
         if (this.cursorY == this.bottom - 1) {
-            this.scrollRegion(0, this.top + 1, this.terminalWidth, this.bottom - this.top - 1, 0, -1, this.color, this.style);
-            offset = undefined;
+            var n = count < this.bottom - this.top ? count : this.bottom - this.top;
+            if (n < 1) {
+                break;
+            }
+            this.scrollRegion(0, this.top + n, this.terminalWidth, this.bottom - this.top - n, 0, -n, this.attr);
+            count -= n;
         } else if (this.cursorY < this.terminalHeight - 1) {
-            this.gotoXY(this.cursorX, this.cursorY + 1);
+            var n = (this.cursorY < this.bottom - 1 ? this.bottom - 1 : this.terminalHeight - 1) - this.cursorY;
+            if (n > count) {
+                n = count;
+            }
+            if (this.offsetMode && (this.cursorY < this.top || this.cursorY >= this.bottom)) {
+                n = 1;
+            }
+            this.gotoXY(this.cursorX, this.cursorY + n);
+            count -= n;
+        } else {
+            break;
         }
     }
 };
@@ -2059,55 +2560,33 @@ VT100.prototype.ri = function(count) {
             count = 1;
         }
     }
-    while (count-- > 0) {
+    while (count > 0) {
         if (this.cursorY == this.top) {
-            this.scrollRegion(0, this.top, this.terminalWidth, this.bottom - this.top - 1, 0, 1, this.color, this.style);
+            var n = count < this.bottom - this.top ? count : this.bottom - this.top;
+            if (n < 1) {
+                break;
+            }
+            this.scrollRegion(0, this.top, this.terminalWidth, this.bottom - this.top - n, 0, n, this.attr);
+            count -= n;
         } else if (this.cursorY > 0) {
-            this.gotoXY(this.cursorX, this.cursorY - 1);
+            var n = this.cursorY - (this.cursorY > this.top ? this.top : 0);
+            if (n > count) {
+                n = count;
+            }
+            if (this.offsetMode && (this.cursorY < this.top || this.cursorY >= this.bottom)) {
+                n = 1;
+            }
+            this.gotoXY(this.cursorX, this.cursorY - n);
+            count -= n;
+        } else {
+            break;
         }
     }
     this.needWrap = false;
 };
 VT100.prototype.respondID = function() { this.respondString += '\u001B[?6c'; };
 VT100.prototype.respondSecondaryDA = function() { this.respondString += '\u001B[>0;0;0c'; };
-VT100.prototype.updateStyle = function() {
-    this.style = '';
-    if (this.attr & 0x0200) {
-        this.style = 'text-decoration:underline;';
-    }
-    var bg = (this.attr >> 4) & 0xF;
-    var fg = this.attr & 0xF;
-    if (this.attr & 0x0100) {
-        var tmp = bg;
-        bg = fg;
-        fg = tmp;
-    }
-    if ((this.attr & (0x0100 | 0x0400)) == 0x0400) {
-        fg = 8;
-    } else if (this.attr & 0x0800) {
-        fg |= 8;
-    }
-    if (this.attr & 0x1000) {
-        bg ^= 8;
-    }
-    if (bg == fg) {
-        if ((fg ^= 8) == 7) {
-            fg = 8;
-        }
-    }
-    if (bg == 7 && fg >= 8) {
-        if ((fg -= 8) == 7) {
-            fg = 8;
-        }
-    }
-    this.color = 'ansi' + fg + ' bgAnsi' + bg;
-};
-VT100.prototype.setAttrColors = function(attr) {
-    if (attr != this.attr) {
-        this.attr = attr;
-        this.updateStyle();
-    }
-};
+VT100.prototype.setAttrColors = function(attr) { this.attr = attr; };
 VT100.prototype.saveCursor = function() {
     this.savedX[this.currentScreen] = this.cursorX;
     this.savedY[this.currentScreen] = this.cursorY;
@@ -2123,7 +2602,6 @@ VT100.prototype.restoreCursor = function() {
         return;
     }
     this.attr = this.savedAttr[this.currentScreen];
-    this.updateStyle();
     this.useGMap = this.savedUseGMap;
     for (var i = 0; i < 4; i++) {
         this.GMap[i] = this.savedGMap[i];
@@ -2168,6 +2646,9 @@ VT100.prototype.setMode = function(state) {
             case 47:
                 this.enableAlternateScreen(state);
                 break;
+            case 2026:
+                this.setSynchronizedOutput(state);
+                break;
             default:
                 break;
             }
@@ -2244,84 +2725,54 @@ VT100.prototype.sendToPrinter = function(s) {
     } catch(e) {
     }
 };
-VT100.prototype.sendControlToPrinter = function(ch) {
+VT100.prototype.sendControlToPrinter = function(ch, action) {
     try {
-        switch (ch) {
-        case 9:
-            this.openPrinterWindow();
-            var doc = this.printWin.document;
-            var print = doc.getElementById('print');
-            var chars = print.lastChild && print.lastChild.nodeName == '#text' ? print.lastChild.textContent.length : 0;
-            this.sendToPrinter(this.spaces(8 - (chars % 8)));
+        switch (action) {
+        case 1:
+            switch (ch) {
+            case 9:
+                this.openPrinterWindow();
+                var doc = this.printWin.document;
+                var print = doc.getElementById('print');
+                var chars = print.lastChild && print.lastChild.nodeName == '#text' ? print.lastChild.textContent.length : 0;
+                this.sendToPrinter(this.spaces(8 - (chars % 8)));
+                break;
+            case 12:
+                this.openPrinterWindow();
+                var pageBreak = this.printWin.document.createElement('div');
+                pageBreak.className = 'pagebreak';
+                pageBreak.innerHTML = '<hr />';
+                this.printWin.document.getElementById('print').appendChild(pageBreak);
+                break;
+            case 13:
+                this.openPrinterWindow();
+                var lineBreak = this.printWin.document.createElement('br');
+                this.printWin.document.getElementById('print').appendChild(lineBreak);
+                break;
+            default:
+                break;
+            }
             break;
-        case 10:
+        case 2:
+            this.clearParams();
+            this.isQuestionMark = false;
             break;
-        case 12:
-            this.openPrinterWindow();
-            var pageBreak = this.printWin.document.createElement('div');
-            pageBreak.className = 'pagebreak';
-            pageBreak.innerHTML = '<hr />';
-            this.printWin.document.getElementById('print').appendChild(pageBreak);
+        case 3:
+            this.isQuestionMark = true;
             break;
-        case 13:
-            this.openPrinterWindow();
-            var lineBreak = this.printWin.document.createElement('br');
-            this.printWin.document.getElementById('print').appendChild(lineBreak);
+        case 4:
+            this.addParamDigit(ch);
             break;
-        case 27:
-            this.isEsc = 1;
+        case 5:
+            this.npar++;
             break;
-        default:
-            switch (this.isEsc) {
-            case 1:
-                this.isEsc = 0;
-                switch (ch) {
-                case 0x5B:
-                    this.isEsc = 2;
-                    break;
-                default:
-                    break;
-                }
-                break;
-            case 2:
-                this.npar = 0;
-                this.par = [0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0];
-                this.isEsc = 3;
-                this.isQuestionMark = ch == 0x3F;
-                if (this.isQuestionMark) {
-                    break;
-                }
-            case 3:
-                if (ch == 0x3B) {
-                    this.npar++;
-                    break;
-                } else if (ch >= 0x30 && ch <= 0x39) {
-                    var par = this.par[this.npar];
-                    if (par == undefined) {
-                        par = 0;
-                    }
-                    this.par[this.npar] = 10 * par + (ch & 0xF);
-                    break;
-                } else {
-                    this.isEsc = 4;
-                }
-            case 4:
-                this.isEsc = 0;
-                if (this.isQuestionMark) {
-                    break;
-                }
-                switch (ch) {
-                case 0x69:
-                    this.csii(this.par[0]);
-                    break;
-                default:
-                    break;
-                }
-                break;
-            default:
-                this.isEsc = 0;
-                break;
+        case 6:
+            if (!this.isQuestionMark && ch == 0x69) {
+                this.csii(this.par[0]);
             }
+            this.isQuestionMark = false;
+            break;
+        default:
             break;
         }
     } catch(e) {
@@ -2334,12 +2785,15 @@ VT100.prototype.csiAt = function(number) {
     if (number > this.terminalWidth - this.cursorX) {
         number = this.terminalWidth - this.cursorX;
     }
-    this.scrollRegion(this.cursorX, this.cursorY, this.terminalWidth - this.cursorX - number, 1, number, 0, this.color, this.style);
+    this.scrollRegion(this.cursorX, this.cursorY, this.terminalWidth - this.cursorX - number, 1, number, 0, this.attr);
     this.needWrap = false;
 };
 VT100.prototype.csii = function(number) {
     switch (number) {
     case 0:
+        if (this.canvas) {
+            this.updatePrintMirror();
+        }
         window.print();
         break;
     case 4:
@@ -2370,19 +2824,19 @@ VT100.prototype.csii = function(number) {
 VT100.prototype.csiJ = function(number) {
     switch (number) {
     case 0:
-        this.clearRegion(this.cursorX, this.cursorY, this.terminalWidth - this.cursorX, 1, this.color, this.style);
+        this.clearRegion(this.cursorX, this.cursorY, this.terminalWidth - this.cursorX, 1, this.attr);
         if (this.cursorY < this.terminalHeight - 2) {
-            this.clearRegion(0, this.cursorY + 1, this.terminalWidth, this.terminalHeight - this.cursorY - 1, this.color, this.style);
+            this.clearRegion(0, this.cursorY + 1, this.terminalWidth, this.terminalHeight - this.cursorY - 1, this.attr);
         }
         break;
     case 1:
         if (this.cursorY > 0) {
-            this.clearRegion(0, 0, this.terminalWidth, this.cursorY, this.color, this.style);
+            this.clearRegion(0, 0, this.terminalWidth, this.cursorY, this.attr);
         }
-        this.clearRegion(0, this.cursorY, this.cursorX + 1, 1, this.color, this.style);
+        this.clearRegion(0, this.cursorY, this.cursorX + 1, 1, this.attr);
         break;
     case 2:
-        this.clearRegion(0, 0, this.terminalWidth, this.terminalHeight, this.color, this.style);
+        this.clearRegion(0, 0, this.terminalWidth, this.terminalHeight, this.attr);
         break;
     default:
         return;
@@ -2392,13 +2846,13 @@ VT100.prototype.csiJ = function(number) {
 VT100.prototype.csiK = function(number) {
     switch (number) {
     case 0:
-        this.clearRegion(this.cursorX, this.cursorY, this.terminalWidth - this.cursorX, 1, this.color, this.style);
+        this.clearRegion(this.cursorX, this.cursorY, this.terminalWidth - this.cursorX, 1, this.attr);
         break;
     case 1:
-        this.clearRegion(0, this.cursorY, this.cursorX + 1, 1, this.color, this.style);
+        this.clearRegion(0, this.cursorY, this.cursorX + 1, 1, this.attr);
         break;
     case 2:
-        this.clearRegion(0, this.cursorY, this.terminalWidth, 1, this.color, this.style);
+        this.clearRegion(0, this.cursorY, this.terminalWidth, 1, this.attr);
         break;
     default:
         return;
@@ -2415,7 +2869,7 @@ VT100.prototype.csiL = function(number) {
     if (number > this.bottom - this.cursorY) {
         number = this.bottom - this.cursorY;
     }
-    this.scrollRegion(0, this.cursorY, this.terminalWidth, this.bottom - this.cursorY - number, 0, number, this.color, this.style);
+    this.scrollRegion(0, this.cursorY, this.terminalWidth, this.bottom - this.cursorY - number, 0, number, this.attr);
     needWrap = false;
 };
 VT100.prototype.csiM = function(number) {
@@ -2428,7 +2882,7 @@ VT100.prototype.csiM = function(number) {
     if (number > this.bottom - this.cursorY) {
         number = bottom - cursorY;
     }
-    this.scrollRegion(0, this.cursorY + number, this.terminalWidth, this.bottom - this.cursorY - number, 0, -number, this.color, this.style);
+    this.scrollRegion(0, this.cursorY + number, this.terminalWidth, this.bottom - this.cursorY - number, 0, -number, this.attr);
     needWrap = false;
 };
 VT100.prototype.csim = function() {
@@ -2481,26 +2935,36 @@ VT100.prototype.csim = function() {
             this.attr &= ~0x0100;
             break;
         case 38:
-            this.attr = (this.attr & ~(0x0400 | 0x0800 | 0x0F)) | 0x0200;
+        case 48:
+            if (this.par[i + 1] == 5 && i + 2 <= this.npar) {
+                this.setColor(this.par[i] == 48, this.par[i + 2] & 0xFF);
+                i += 2;
+            } else if (this.par[i + 1] == 2 && i + 4 <= this.npar) {
+                this.setColor(this.par[i] == 48, this.getTrueColor(this.par[i + 2], this.par[i + 3], this.par[i + 4]));
+                i += 4;
+            } else {
+                i = this.npar;
+            }
             break;
         case 39:
-            this.attr &= ~(0x0400 | 0x0800 | 0x0200 | 0x0F);
+            this.attr &= ~0x003FE00F;
             break;
         case 49:
-            this.attr |= 0xF0;
+            this.attr = (this.attr & ~0x7FC00000) | 0xF0;
             break;
         default:
             if (this.par[i] >= 30 && this.par[i] <= 37) {
-                var fg = this.par[i] - 30;
-                this.attr = (this.attr & ~0x0F) | fg;
+                this.setColor(false, this.par[i] - 30);
             } else if (this.par[i] >= 40 && this.par[i] <= 47) {
-                var bg = this.par[i] - 40;
-                this.attr = (this.attr & ~0xF0) | (bg << 4);
+                this.setColor(true, this.par[i] - 40);
+            } else if (this.par[i] >= 90 && this.par[i] <= 97) {
+                this.setColor(false, this.par[i] - 82);
+            } else if (this.par[i] >= 100 && this.par[i] <= 107) {
+                this.setColor(true, this.par[i] - 92);
             }
             break;
         }
     }
-    this.updateStyle();
 };
 VT100.prototype.csiP = function(number) {
     if (number == 0) {
@@ -2509,7 +2973,7 @@ VT100.prototype.csiP = function(number) {
     if (number > this.terminalWidth - this.cursorX) {
         number = this.terminalWidth - this.cursorX;
     }
-    this.scrollRegion(this.cursorX + number, this.cursorY, this.terminalWidth - this.cursorX - number, 1, -number, 0, this.color, this.style);
+    this.scrollRegion(this.cursorX + number, this.cursorY, this.terminalWidth - this.cursorX - number, 1, -number, 0, this.attr);
     needWrap = false;
 };
 VT100.prototype.csiX = function(number) {
@@ -2519,19 +2983,96 @@ VT100.prototype.csiX = function(number) {
     if (number > this.terminalWidth - this.cursorX) {
         number = this.terminalWidth - this.cursorX;
     }
-    this.clearRegion(this.cursorX, this.cursorY, number, 1, this.color, this.style);
+    this.clearRegion(this.cursorX, this.cursorY, number, 1, this.attr);
     needWrap = false;
 };
 VT100.prototype.settermCommand = function() {
 };
 VT100.prototype.doControl = function(ch) {
+    var state = this.isEsc;
+    var entry = (this.printing ? this.printTable : this.escTable)[state * 256 + (ch < 256 ? ch : 0xFF)];
+    this.isEsc = entry & 0x1F;
     if (this.printing) {
-        this.sendControlToPrinter(ch);
+        this.sendControlToPrinter(ch, entry >> 5);
         return '';
     }
-    var lineBuf = '';
+    switch (entry >> 5) {
+    case 1:
+        this.execute(ch);
+        break;
+    case 2:
+        this.escDispatch(ch);
+        break;
+    case 3:
+        this.csiEntry();
+        break;
+    case 4:
+        this.addParamDigit(ch);
+        break;
+    case 5:
+        this.npar++;
+        break;
+    case 6:
+        return this.csiDispatch(ch);
+    case 7:
+        if (ch == 0x63 && this.par[0] == 0) {
+            this.respondSecondaryDA();
+        }
+        break;
+    case 8:
+        this.oscDispatch(ch);
+        break;
+    case 9:
+        this.par[this.npar++] = ch > 0x39 ? (ch & 0xDF) - 55 : (ch & 0xF);
+        break;
+    case 10:
+        this.statusString += String.fromCharCode(ch);
+        break;
+    case 11:
+        if (this.statusString && this.statusString.charAt(0) == ';') {
+            this.statusString = this.statusString.substr(1);
+        }
+        try {
+            window.status = this.statusString;
+        } catch(e) {
+        }
+        break;
+    case 12:
+        this.designateCharset(state - 8, ch);
+        break;
+    case 13:
+        if (ch == 0x40) {
+            this.utfEnabled = false;
+        } else if (ch == 0x47 || ch == 0x38) {
+            this.utfEnabled = true;
+        }
+        break;
+    case 14:
+        if (ch < 256) {
+            ch = this.GMap[state - 18 + 2][this.toggleMeta ? (ch | 0x80) : ch];
+            if ((ch & 0xFF00) == 0xF000) {
+                ch = ch & 0xFF;
+            } else if (ch == 0xFEFF || (ch >= 0x200A && ch <= 0x200F)) {
+                break;
+            }
+        }
+        this.lastCharacter = String.fromCharCode(ch);
+        return this.lastCharacter;
+    case 15:
+        this.isQuestionMark = true;
+        break;
+    case 16:
+        this.isDollar = true;
+        break;
+    default:
+        break;
+    }
+    return '';
+};
+VT100.prototype.execute = function(ch, count) {
     switch (ch) {
-    case 0x00:
+    case 0x07:
+        this.beep();
         break;
     case 0x08:
         this.bs();
@@ -2543,7 +3084,7 @@ VT100.prototype.doControl = function(ch) {
     case 0x0B:
     case 0x0C:
     case 0x84:
-        this.lf();
+        this.lineFeed(count || 1);
         if (!this.crLfMode) break;
     case 0x0D:
         this.cr();
@@ -2562,474 +3103,364 @@ VT100.prototype.doControl = function(ch) {
         this.translate = this.GMap[0];
         this.dispCtrl = false;
         break;
-    case 0x18:
-    case 0x1A:
-        this.isEsc = 0;
-        break;
-    case 0x1B:
-        this.isEsc = 1;
-        break;
-    case 0x7F:
-        break;
     case 0x88:
         this.userTabStop[this.cursorX] = true;
         break;
     case 0x8D:
         this.ri();
         break;
-    case 0x8E:
-        this.isEsc = 18;
+    case 0x9A:
+        this.respondID();
         break;
-    case 0x8F:
-        this.isEsc = 19;
+    default:
         break;
-    case 0x9A:
+    }
+};
+VT100.prototype.escDispatch = function(ch) {
+    switch (ch) {
+    case 0x37:
+        this.saveCursor();
+        break;
+    case 0x38:
+        this.restoreCursor();
+        break;
+    case 0x3E:
+        this.applKeyMode = false;
+        break;
+    case 0x3D:
+        this.applKeyMode = true;
+        break;
+    case 0x44:
+        this.lf();
+        break;
+    case 0x45:
+        this.cr();
+        this.lf();
+        break;
+    case 0x4D:
+        this.ri();
+        break;
+    case 0x48:
+        this.userTabStop[this.cursorX] = true;
+        break;
+    case 0x5A:
         this.respondID();
         break;
-    case 0x9B:
-        this.isEsc = 2;
+    case 0x63:
+        this.reset();
+        break;
+    case 0x67:
+        this.flashScreen();
         break;
-    case 0x07:
-        if (this.isEsc != 17) {
-            this.beep();
-            break;
-        }
     default:
-        switch (this.isEsc) {
-        case 1:
-            this.isEsc = 0;
-            switch (ch) {
-            case 0x25:
-                this.isEsc = 13;
-                break;
-            case 0x28:
-                this.isEsc = 8;
-                break;
-            case 0x2D:
-            case 0x29:
-                this.isEsc = 9;
-                break;
-            case 0x2E:
-            case 0x2A:
-                this.isEsc = 10;
-                break;
-            case 0x2F:
-            case 0x2B:
-                this.isEsc = 11;
-                break;
-            case 0x23:
-                this.isEsc = 7;
-                break;
-            case 0x37:
-                this.saveCursor();
-                break;
-            case 0x38:
-                this.restoreCursor();
-                break;
-            case 0x3E:
-                this.applKeyMode = false;
-                break;
-            case 0x3D:
-                this.applKeyMode = true;
-                break;
-            case 0x44:
-                this.lf();
-                break;
-            case 0x45:
-                this.cr();
-                this.lf();
-                break;
-            case 0x4D:
-                this.ri();
-                break;
-            case 0x4E:
-                this.isEsc = 18;
-                break;
-            case 0x4F:
-                this.isEsc = 19;
-                break;
-            case 0x48:
-                this.userTabStop[this.cursorX] = true;
-                break;
-            case 0x5A:
-                this.respondID();
-                break;
-            case 0x5B:
-                this.isEsc = 2;
-                break;
-            case 0x5D:
-                this.isEsc = 15;
-                break;
-            case 0x63:
-                this.reset();
-                break;
-            case 0x67:
-                this.flashScreen();
-                break;
-            default:
-                break;
-            }
+        break;
+    }
+};
+VT100.prototype.oscDispatch = function(ch) {
+    if (ch == 0x50) {
+        this.clearParams();
+    } else {
+        this.statusString = '';
+    }
+};
+VT100.prototype.designateCharset = function(g, ch) {
+    switch (ch) {
+    case 0x30:
+        this.GMap[g] = this.VT100GraphicsMap;
+        break;
+    case 0x42:
+        this.GMap[g] = this.Latin1Map;
+        break;
+    case 0x55:
+        this.GMap[g] = this.CodePage437Map;
+        break;
+    case 0x4B:
+        this.GMap[g] = this.DirectToFontMap;
+        break;
+    default:
+        break;
+    }
+    if (this.useGMap == g) {
+        this.translate = this.GMap[g];
+    }
+};
+VT100.prototype.clearParams = function() {
+    for (var i = this.npar < this.par.length ? this.npar : this.par.length - 1; i >= 0; i--) {
+        this.par[i] = 0;
+    }
+    this.npar = 0;
+};
+VT100.prototype.addParamDigit = function(ch) {
+    if (this.npar < this.par.length && this.par[this.npar] < 100000000) {
+        this.par[this.npar] = 10 * this.par[this.npar] + (ch & 0xF);
+    }
+};
+VT100.prototype.csiEntry = function() {
+    this.clearParams();
+    this.isQuestionMark = false;
+    this.isDollar = false;
+};
+VT100.prototype.csiDispatch = function(ch) {
+    var lineBuf = '';
+    if (this.isQuestionMark) {
+        switch (ch) {
+        case 0x68:
+            this.setMode(true);
             break;
-        case 15:
-            switch (ch) {
-            case 0x30:
-            case 0x31:
-            case 0x32:
-                this.statusString = '';
-                this.isEsc = 17;
-                break;
-            case 0x50:
-                this.npar = 0;
-                this.par = [0, 0, 0, 0, 0, 0, 0];
-                this.isEsc = 16;
-                break;
-            case 0x52:
-                this.isEsc = 0;
-                break;
-            default:
-                this.isEsc = 0;
-                break;
-            }
+        case 0x6C:
+            this.setMode(false);
             break;
-        case 16:
-            if ((ch >= 0x30 && ch <= 0x39) || (ch >= 0x41 && ch <= 0x46) || (ch >= 0x61 && ch <= 0x66)) {
-                this.par[this.npar++] = ch > 0x39 ? (ch & 0xDF) - 55 : (ch & 0xF);
-                if (this.npar == 7) {
-                    this.isEsc = 0;
-                }
-            } else {
-                this.isEsc = 0;
+        case 0x63:
+            this.setCursorAttr(this.par[2], this.par[1]);
+            break;
+        case 0x70:
+            if (this.isDollar) {
+                this.respondString += '\u001B[?' + this.par[0] + ';' + (this.par[0] == 2026 ? (this.synchronizedOutput ? 1 : 2) : 0) + '$y';
             }
             break;
-        case 2:
-            this.npar = 0;
-            this.par = [0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0];
-            this.isEsc = 3;
-            if (ch == 0x5B) {
-                this.isEsc = 6;
-                break;
-            } else {
-                this.isQuestionMark = ch == 0x3F;
-                if (this.isQuestionMark) {
-                    break;
-                }
+        default:
+            break;
+        }
+        this.isQuestionMark = false;
+        return lineBuf;
+    }
+    switch (ch) {
+    case 0x47:
+    case 0x60:
+        this.gotoXY(this.par[0] - 1, this.cursorY);
+        break;
+    case 0x41:
+        this.gotoXY(this.cursorX, this.cursorY - (this.par[0] ? this.par[0] : 1));
+        break;
+    case 0x42:
+    case 0x65:
+        this.gotoXY(this.cursorX, this.cursorY + (this.par[0] ? this.par[0] : 1));
+        break;
+    case 0x43:
+    case 0x61:
+        this.gotoXY(this.cursorX + (this.par[0] ? this.par[0] : 1), this.cursorY);
+        break;
+    case 0x44:
+        this.gotoXY(this.cursorX - (this.par[0] ? this.par[0] : 1), this.cursorY);
+        break;
+    case 0x45:
+        this.gotoXY(0, this.cursorY + (this.par[0] ? this.par[0] : 1));
+        break;
+    case 0x46:
+        this.gotoXY(0, this.cursorY - (this.par[0] ? this.par[0] : 1));
+        break;
+    case 0x64:
+        this.gotoXaY(this.cursorX, this.par[0] - 1);
+        break;
+    case 0x48:
+    case 0x66:
+        this.gotoXaY(this.par[1] - 1, this.par[0] - 1);
+        break;
+    case 0x49:
+        this.ht(this.par[0] ? this.par[0] : 1);
+        break;
+    case 0x40:
+        this.csiAt(this.par[0]);
+        break;
+    case 0x69:
+        this.csii(this.par[0]);
+        break;
+    case 0x4A:
+        this.csiJ(this.par[0]);
+        break;
+    case 0x4B:
+        this.csiK(this.par[0]);
+        break;
+    case 0x4C:
+        this.csiL(this.par[0]);
+        break;
+    case 0x4D:
+        this.csiM(this.par[0]);
+        break;
+    case 0x6D:
+        this.csim();
+        break;
+    case 0x50:
+        this.csiP(this.par[0]);
+        break;
+    case 0x58:
+        this.csiX(this.par[0]);
+        break;
+    case 0x53:
+        this.lf(this.par[0] ? this.par[0] : 1);
+        break;
+    case 0x54:
+        this.ri(this.par[0] ? this.par[0] : 1);
+        break;
+    case 0x63:
+        if (!this.par[0]) this.respondID();
+        break;
+    case 0x67:
+        if (this.par[0] == 0) {
+            this.userTabStop[this.cursorX] = false;
+        } else if (this.par[0] == 2 || this.par[0] == 3) {
+            this.userTabStop = [];
+            for (var i = 0; i < this.terminalWidth; i++) {
+                this.userTabStop[i] = false;
             }
+        }
+        break;
+    case 0x68:
+        this.setMode(true);
+        break;
+    case 0x6C:
+        this.setMode(false);
+        break;
+    case 0x6E:
+        switch (this.par[0]) {
         case 5:
-        case 3:
-            if (ch == 0x3B) {
-                this.npar++;
-                break;
-            } else if (ch >= 0x30 && ch <= 0x39) {
-                var par = this.par[this.npar];
-                if (par == undefined) {
-                    par = 0;
-                }
-                this.par[this.npar] = 10 * par + (ch & 0xF);
+            this.statusReport();
+            break;
+        case 6:
+            this.cursorReport();
+            break;
+        default:
+            break;
+        }
+        break;
+    case 0x71:
+        break;
+    case 0x72:
+        var t = this.par[0] ? this.par[0] : 1;
+        var b = this.par[1] ? this.par[1] : this.terminalHeight;
+        if (t < b && b <= this.terminalHeight) {
+            this.top = t - 1;
+            this.bottom = b;
+            this.gotoXaY(0, 0);
+        }
+        break;
+    case 0x62:
+        var c = this.par[0] ? this.par[0] : 1;
+        if (c > this.terminalWidth * this.terminalHeight) {
+            c = this.terminalWidth * this.terminalHeight;
+        }
+        while (c-- > 0) {
+            lineBuf += this.lastCharacter;
+        }
+        break;
+    case 0x73:
+        this.saveCursor();
+        break;
+    case 0x75:
+        this.restoreCursor();
+        break;
+    case 0x5A:
+        this.rt(this.par[0] ? this.par[0] : 1);
+        break;
+    case 0x5D:
+        this.settermCommand();
+        break;
+    default:
+        break;
+    }
+    return lineBuf;
+};
+VT100.prototype.renderString = function(s, showCursor) {
+    if (this.printing) {
+        this.sendToPrinter(s);
+        if (showCursor) {
+            this.showCursor();
+        }
+        return;
+    }
+    var incX = s.length;
+    if (incX > this.terminalWidth - this.cursorX) {
+        incX = this.terminalWidth - this.cursorX;
+        if (incX <= 0) {
+            return;
+        }
+        var last = s.charCodeAt(s.length - 1);
+        s = s.substr(0, incX - 1) + s.substr(s.length - (last >= 0xDC00 && last < 0xE000 ? 2 : 1));
+    }
+    if (showCursor) {
+        this.cursor.style.visibility = '';
+    }
+    this.putString(this.cursorX, this.cursorY, s, this.attr);
+};
+VT100.prototype.vt100Bytes = function(bytes) {
+    if (this.worker) {
+        this.postToWorker(bytes);
+        return '';
+    }
+    if (this.utfEnabled && this.utfDecoder) {
+        return this.vt100(this.utfDecoder.decode(bytes, { stream: true }), true);
+    }
+    var s = '';
+    for (var i = 0; i < bytes.length; i += 0x2000) {
+        s += String.fromCharCode.apply(String, bytes.subarray(i, i + 0x2000));
+    }
+    return this.vt100(s);
+};
+VT100.prototype.vt100 = function(s, decoded) {
+    if (this.worker) {
+        this.postToWorker(s, decoded);
+        return '';
+    }
+    this.cursorNeedsShowing = this.hideCursor();
+    this.respondString = '';
+    var lineBuf = '';
+    var expanding = false;
+    var outer, outerI, outerDecoded;
+    for (var i = 0; ; i++) {
+        if (i >= s.length) {
+            if (!expanding) {
                 break;
-            } else if (this.isEsc == 5) {
-                switch (ch) {
-                case 0x63:
-                    if (this.par[0] == 0) this.respondSecondaryDA();
-                    break;
-                case 0x6D:
-                    break;
-                case 0x6E:
-                    break;
-                case 0x70:
-                    break;
-                default:
-                    break;
-                }
-                this.isEsc = 0;
-                break;
-            } else {
-                this.isEsc = 4;
             }
-        case 4:
-            this.isEsc = 0;
-            if (this.isQuestionMark) {
-                switch (ch) {
-                case 0x68:
-                    this.setMode(true);
-                    break;
-                case 0x6C:
-                    this.setMode(false);
-                    break;
-                case 0x63:
-                    this.setCursorAttr(this.par[2], this.par[1]);
-                    break;
-                default:
-                    break;
-                }
-                this.isQuestionMark = false;
-                break;
+            s = outer;
+            i = outerI;
+            decoded = outerDecoded;
+            expanding = false;
+            continue;
+        }
+        var ch = s.charCodeAt(i);
+        if (ch >= 0x20 && ch < 0x7F && this.isEsc == 0 && !this.printing && !this.insertMode && !this.toggleMeta && this.translate != this.VT100GraphicsMap) {
+            var end = i + 1;
+            while (end < s.length && (ch = s.charCodeAt(end)) >= 0x20 && ch < 0x7F) {
+                end++;
             }
-            switch (ch) {
-            case 0x21:
-                this.isEsc = 12;
-                break;
-            case 0x3E:
-                if (!this.npar) this.isEsc = 5;
-                break;
-            case 0x47:
-            case 0x60:
-                this.gotoXY(this.par[0] - 1, this.cursorY);
-                break;
-            case 0x41:
-                this.gotoXY(this.cursorX, this.cursorY - (this.par[0] ? this.par[0] : 1));
-                break;
-            case 0x42:
-            case 0x65:
-                this.gotoXY(this.cursorX, this.cursorY + (this.par[0] ? this.par[0] : 1));
-                break;
-            case 0x43:
-            case 0x61:
-                this.gotoXY(this.cursorX + (this.par[0] ? this.par[0] : 1), this.cursorY);
-                break;
-            case 0x44:
-                this.gotoXY(this.cursorX - (this.par[0] ? this.par[0] : 1), this.cursorY);
-                break;
-            case 0x45:
-                this.gotoXY(0, this.cursorY + (this.par[0] ? this.par[0] : 1));
-                break;
-            case 0x46:
-                this.gotoXY(0, this.cursorY - (this.par[0] ? this.par[0] : 1));
-                break;
-            case 0x64:
-                this.gotoXaY(this.cursorX, this.par[0] - 1);
-                break;
-            case 0x48:
-            case 0x66:
-                this.gotoXaY(this.par[1] - 1, this.par[0] - 1);
-                break;
-            case 0x49:
-                this.ht(this.par[0] ? this.par[0] : 1);
-                break;
-            case 0x40:
-                this.csiAt(this.par[0]);
-                break;
-            case 0x69:
-                this.csii(this.par[0]);
-                break;
-            case 0x4A:
-                this.csiJ(this.par[0]);
-                break;
-            case 0x4B:
-                this.csiK(this.par[0]);
-                break;
-            case 0x4C:
-                this.csiL(this.par[0]);
-                break;
-            case 0x4D:
-                this.csiM(this.par[0]);
-                break;
-            case 0x6D:
-                this.csim();
-                break;
-            case 0x50:
-                this.csiP(this.par[0]);
-                break;
-            case 0x58:
-                this.csiX(this.par[0]);
-                break;
-            case 0x53:
-                this.lf(this.par[0] ? this.par[0] : 1);
-                break;
-            case 0x54:
-                this.ri(this.par[0] ? this.par[0] : 1);
-                break;
-            case 0x63:
-                if (!this.par[0]) this.respondID();
-                break;
-            case 0x67:
-                if (this.par[0] == 0) {
-                    this.userTabStop[this.cursorX] = false;
-                } else if (this.par[0] == 2 || this.par[0] == 3) {
-                    this.userTabStop = [];
-                    for (var i = 0; i < this.terminalWidth; i++) {
-                        this.userTabStop[i] = false;
+            this.utfCount = 0;
+            for (var j = i; j < end; ) {
+                if (this.needWrap) {
+                    if (lineBuf) {
+                        this.renderString(lineBuf);
+                        lineBuf = '';
                     }
+                    this.cr();
+                    this.lf();
                 }
-                break;
-            case 0x68:
-                this.setMode(true);
-                break;
-            case 0x6C:
-                this.setMode(false);
-                break;
-            case 0x6E:
-                switch (this.par[0]) {
-                case 5:
-                    this.statusReport();
-                    break;
-                case 6:
-                    this.cursorReport();
-                    break;
-                default:
-                    break;
-                }
-                break;
-            case 0x71:
-                break;
-            case 0x72:
-                var t = this.par[0] ? this.par[0] : 1;
-                var b = this.par[1] ? this.par[1] : this.terminalHeight;
-                if (t < b && b <= this.terminalHeight) {
-                    this.top = t - 1;
-                    this.bottom = b;
-                    this.gotoXaY(0, 0);
-                }
-                break;
-            case 0x62:
-                var c = this.par[0] ? this.par[0] : 1;
-                if (c > this.terminalWidth * this.terminalHeight) {
-                    c = this.terminalWidth * this.terminalHeight;
+                var run = end - j;
+                if (this.autoWrapMode) {
+                    run = Math.max(1, Math.min(run, this.terminalWidth - this.cursorX - lineBuf.length));
                 }
-                while (c-- > 0) {
-                    lineBuf += this.lastCharacter;
+                lineBuf += s.substring(j, j + run);
+                j += run;
+                if (this.cursorX + lineBuf.length >= this.terminalWidth) {
+                    this.needWrap = this.autoWrapMode;
                 }
-                break;
-            case 0x73:
-                this.saveCursor();
-                break;
-            case 0x75:
-                this.restoreCursor();
-                break;
-            case 0x5A:
-                this.rt(this.par[0] ? this.par[0] : 1);
-                break;
-            case 0x5D:
-                this.settermCommand();
-                break;
-            default:
-                break;
-            }
-            break;
-        case 12:
-            if (ch == 'p') {
-                this.reset();
-            }
-            this.isEsc = 0;
-            break;
-        case 13:
-            this.isEsc = 0;
-            switch (ch) {
-            case 0x40:
-                this.utfEnabled = false;
-                break;
-            case 0x47:
-            case 0x38:
-                this.utfEnabled = true;
-                break;
-            default:
-                break;
-            }
-            break;
-        case 6:
-            this.isEsc = 0;
-            break;
-        case 7:
-            this.isEsc = 0;
-            if (ch == 0x38) {
             }
-            break;
-        case 8:
-        case 9:
-        case 10:
-        case 11:
-            var g = this.isEsc - 8;
-            this.isEsc = 0;
-            switch (ch) {
-            case 0x30:
-                this.GMap[g] = this.VT100GraphicsMap;
-                break;
-            case 0x42:
-            case 0x42:
-                this.GMap[g] = this.Latin1Map;
-                break;
-            case 0x55:
-                this.GMap[g] = this.CodePage437Map;
-                break;
-            case 0x4B:
-                this.GMap[g] = this.DirectToFontMap;
-                break;
-            default:
-                break;
-            }
-            if (this.useGMap == g) {
-                this.translate = this.GMap[g];
-            }
-            break;
-        case 17:
-            if (ch == 0x07) {
-                if (this.statusString && this.statusString.charAt(0) == ';') {
-                    this.statusString = this.statusString.substr(1);
-                }
-                try {
-                    window.status = this.statusString;
-                } catch(e) {
-                }
-                this.isEsc = 0;
-            } else {
-                this.statusString += String.fromCharCode(ch);
-            }
-            break;
-        case 18:
-        case 19:
-            if (ch < 256) {
-                ch = this.GMap[this.isEsc - 18 + 2][this.toggleMeta ? (ch | 0x80) : ch];
-                if ((ch & 0xFF00) == 0xF000) {
-                    ch = ch & 0xFF;
-                } else if (ch == 0xFEFF || (ch >= 0x200A && ch <= 0x200F)) {
-                    this.isEsc = 0;
-                    break;
+            this.lastCharacter = s.charAt(end - 1);
+            i = end - 1;
+            continue;
+        }
+        if (decoded) {
+            if (ch >= 0xD800 && ch < 0xDC00 && i + 1 < s.length) {
+                var low = s.charCodeAt(i + 1);
+                if (low >= 0xDC00 && low < 0xE000) {
+                    ch = ((ch - 0xD800) << 10) + low - 0xDC00 + 0x10000;
+                    i++;
                 }
             }
-            this.lastCharacter = String.fromCharCode(ch);
-            lineBuf += this.lastCharacter;
-            this.isEsc = 0;
-            break;
-        default:
-            this.isEsc = 0;
-            break;
-        }
-        break;
-    }
-    return lineBuf;
-};
-VT100.prototype.renderString = function(s, showCursor) {
-    if (this.printing) {
-        this.sendToPrinter(s);
-        if (showCursor) {
-            this.showCursor();
-        }
-        return;
-    }
-    var incX = s.length;
-    if (incX > this.terminalWidth - this.cursorX) {
-        incX = this.terminalWidth - this.cursorX;
-        if (incX <= 0) {
-            return;
-        }
-        s = s.substr(0, incX - 1) + s.charAt(s.length - 1);
-    }
-    if (showCursor) {
-        this.cursor.style.visibility = '';
-    }
-    this.putString(this.cursorX, this.cursorY, s, this.color, this.style);
-};
-VT100.prototype.vt100 = function(s) {
-    this.cursorNeedsShowing = this.hideCursor();
-    this.respondString = '';
-    var lineBuf = '';
-    for (var i = 0; i < s.length; i++) {
-        var ch = s.charCodeAt(i);
-        if (this.utfEnabled) {
+        } else if (this.utfEnabled) {
             if (ch > 0x7F) {
                 if (this.utfCount > 0 && (ch & 0xC0) == 0x80) {
                     this.utfChar = (this.utfChar << 6) | (ch & 0x3F);
                     if (--this.utfCount <= 0) {
-                        if (this.utfChar > 0xFFFF || this.utfChar < 0) {
+                        if (this.utfChar > 0x10FFFF || this.utfChar < 0) {
                             ch = 0xFFFD;
                         } else {
                             ch = this.utfChar;
@@ -3064,10 +3495,10 @@ VT100.prototype.vt100 = function(s) {
         }
         var isNormalCharacter = (ch >= 32 && ch <= 127 || ch >= 160 || this.utfEnabled && ch >= 128 || !(this.dispCtrl ? this.ctrlAlways : this.ctrlAction)[ch & 0x1F]) && (ch != 0x7F || this.dispCtrl);
         if (isNormalCharacter && this.isEsc == 0) {
-            if (ch < 256) {
+            if (ch < 256 && !expanding && (this.translate != this.Latin1Map || this.toggleMeta)) {
                 ch = this.translate[this.toggleMeta ? (ch | 0x80) : ch];
             }
-            if ((ch & 0xFF00) == 0xF000) {
+            if (ch >= 0xF000 && ch <= 0xF0FF) {
                 ch = ch & 0xFF;
             } else if (ch == 0xFEFF || (ch >= 0x200A && ch <= 0x200F)) {
                 continue;
@@ -3084,9 +3515,22 @@ VT100.prototype.vt100 = function(s) {
                     this.lf();
                 }
                 if (this.insertMode) {
-                    this.scrollRegion(this.cursorX, this.cursorY, this.terminalWidth - this.cursorX - 1, 1, 1, 0, this.color, this.style);
+                    this.scrollRegion(this.cursorX, this.cursorY, this.terminalWidth - this.cursorX - 1, 1, 1, 0, this.attr);
                 }
             }
+            if (ch > 0xFFFF) {
+                if (lineBuf) {
+                    this.renderString(lineBuf);
+                    lineBuf = '';
+                }
+                var x = this.cursorX;
+                this.lastCharacter = String.fromCodePoint(ch);
+                this.renderString(this.lastCharacter);
+                if (!this.printing && x + 1 >= this.terminalWidth) {
+                    this.needWrap = this.autoWrapMode;
+                }
+                continue;
+            }
             this.lastCharacter = String.fromCharCode(ch);
             lineBuf += this.lastCharacter;
             if (!this.printing && this.cursorX + lineBuf.length >= this.terminalWidth) {
@@ -3097,10 +3541,32 @@ VT100.prototype.vt100 = function(s) {
                 this.renderString(lineBuf);
                 lineBuf = '';
             }
+            if (ch >= 0x0A && ch <= 0x0C && this.isEsc == 0 && !this.printing && !this.dispCtrl) {
+                var count = 1;
+                var cr = false;
+                for (var next; i + 1 < s.length && (next = s.charCodeAt(i + 1)) >= 0x0A && next <= 0x0D; i++) {
+                    if (next == 0x0D) {
+                        cr = true;
+                    } else {
+                        count++;
+                    }
+                }
+                this.utfCount = 0;
+                this.execute(ch, count);
+                if (cr) {
+                    this.execute(0x0D);
+                }
+                continue;
+            }
             var expand = this.doControl(ch);
-            if (expand.length) {
-                var r = this.respondString;
-                this.respondString = r + this.vt100(expand);
+            if (expand.length && !expanding) {
+                expanding = true;
+                outer = s;
+                outerI = i;
+                outerDecoded = decoded;
+                s = expand;
+                i = -1;
+                decoded = true;
             }
         }
     }
@@ -3115,6 +3581,111 @@ VT100.prototype.Latin1Map = [0x0000, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x0
 VT100.prototype.VT100GraphicsMap = [0x0000, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x0006, 0x0007, 0x0008, 0x0009, 0x000A, 0x000B, 0x000C, 0x000D, 0x000E, 0x000F, 0x0010, 0x0011, 0x0012, 0x0013, 0x0014, 0x0015, 0x0016, 0x0017, 0x0018, 0x0019, 0x001A, 0x001B, 0x001C, 0x001D, 0x001E, 0x001F, 0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027, 0x0028, 0x0029, 0x002A, 0x2192, 0x2190, 0x2191, 0x2193, 0x002F, 0x2588, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037, 0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F, 0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047, 0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F, 0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057, 0x0058, 0x0059, 0x005A, 0x005B, 0x005C, 0x005D, 0x005E, 0x00A0, 0x25C6, 0x2592, 0x2409, 0x240C, 0x240D, 0x240A, 0x00B0, 0x00B1, 0x2591, 0x240B, 0x2518, 0x2510, 0x250C, 0x2514, 0x253C, 0xF800, 0xF801, 0x2500, 0xF803, 0xF804, 0x251C, 0x2524, 0x2534, 0x252C, 0x2502, 0x2264, 0x2265, 0x03C0, 0x2260, 0x00A3, 0x00B7, 0x007F, 0x0080, 0x0081, 0x0082, 0x0083, 0x0084, 0x0085, 0x0086, 0x0087, 0x0088, 0x0089, 0x008A, 0x008B, 0x008C, 0x008D, 0x008E, 0x008F, 0x0090, 0x0091, 0x0092, 0x0093, 0x0094, 0x0095, 0x0096, 0x0097, 0x0098, 0x0099, 0x009A, 0x009B, 0x009C, 0x009D, 0x009E, 0x009F, 0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7, 0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF, 0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7, 0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF, 0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7, 0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF, 0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7, 0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF, 0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7, 0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF, 0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7, 0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF];
 VT100.prototype.CodePage437Map = [0x0000, 0x263A, 0x263B, 0x2665, 0x2666, 0x2663, 0x2660, 0x2022, 0x25D8, 0x25CB, 0x25D9, 0x2642, 0x2640, 0x266A, 0x266B, 0x263C, 0x25B6, 0x25C0, 0x2195, 0x203C, 0x00B6, 0x00A7, 0x25AC, 0x21A8, 0x2191, 0x2193, 0x2192, 0x2190, 0x221F, 0x2194, 0x25B2, 0x25BC, 0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027, 0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F, 0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037, 0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F, 0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047, 0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F, 0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057, 0x0058, 0x0059, 0x005A, 0x005B, 0x005C, 0x005D, 0x005E, 0x005F, 0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067, 0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F, 0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077, 0x0078, 0x0079, 0x007A, 0x007B, 0x007C, 0x007D, 0x007E, 0x2302, 0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7, 0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5, 0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9, 0x00FF, 0x00D6, 0x00DC, 0x00A2, 0x00A3, 0x00A5, 0x20A7, 0x0192, 0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA, 0x00BF, 0x2310, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB, 0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556, 0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510, 0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F, 0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567, 0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B, 0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580, 0x03B1, 0x00DF, 0x0393, 0x03C0, 0x03A3, 0x03C3, 0x00B5, 0x03C4, 0x03A6, 0x0398, 0x03A9, 0x03B4, 0x221E, 0x03C6, 0x03B5, 0x2229, 0x2261, 0x00B1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00F7, 0x2248, 0x00B0, 0x2219, 0x00B7, 0x221A, 0x207F, 0x00B2, 0x25A0, 0x00A0];
 VT100.prototype.DirectToFontMap = [0xF000, 0xF001, 0xF002, 0xF003, 0xF004, 0xF005, 0xF006, 0xF007, 0xF008, 0xF009, 0xF00A, 0xF00B, 0xF00C, 0xF00D, 0xF00E, 0xF00F, 0xF010, 0xF011, 0xF012, 0xF013, 0xF014, 0xF015, 0xF016, 0xF017, 0xF018, 0xF019, 0xF01A, 0xF01B, 0xF01C, 0xF01D, 0xF01E, 0xF01F, 0xF020, 0xF021, 0xF022, 0xF023, 0xF024, 0xF025, 0xF026, 0xF027, 0xF028, 0xF029, 0xF02A, 0xF02B, 0xF02C, 0xF02D, 0xF02E, 0xF02F, 0xF030, 0xF031, 0xF032, 0xF033, 0xF034, 0xF035, 0xF036, 0xF037, 0xF038, 0xF039, 0xF03A, 0xF03B, 0xF03C, 0xF03D, 0xF03E, 0xF03F, 0xF040, 0xF041, 0xF042, 0xF043, 0xF044, 0xF045, 0xF046, 0xF047, 0xF048, 0xF049, 0xF04A, 0xF04B, 0xF04C, 0xF04D, 0xF04E, 0xF04F, 0xF050, 0xF051, 0xF052, 0xF053, 0xF054, 0xF055, 0xF056, 0xF057, 0xF058, 0xF059, 0xF05A, 0xF05B, 0xF05C, 0xF05D, 0xF05E, 0xF05F, 0xF060, 0xF061, 0xF062, 0xF063, 0xF064, 0xF065, 0xF066, 0xF067, 0xF068, 0xF069, 0xF06A, 0xF06B, 0xF06C, 0xF06D, 0xF06E, 0xF06F, 0xF070, 0xF071, 0xF072, 0xF073, 0xF074, 0xF075, 0xF076, 0xF077, 0xF078, 0xF079, 0xF07A, 0xF07B, 0xF07C, 0xF07D, 0xF07E, 0xF07F, 0xF080, 0xF081, 0xF082, 0xF083, 0xF084, 0xF085, 0xF086, 0xF087, 0xF088, 0xF089, 0xF08A, 0xF08B, 0xF08C, 0xF08D, 0xF08E, 0xF08F, 0xF090, 0xF091, 0xF092, 0xF093, 0xF094, 0xF095, 0xF096, 0xF097, 0xF098, 0xF099, 0xF09A, 0xF09B, 0xF09C, 0xF09D, 0xF09E, 0xF09F, 0xF0A0, 0xF0A1, 0xF0A2, 0xF0A3, 0xF0A4, 0xF0A5, 0xF0A6, 0xF0A7, 0xF0A8, 0xF0A9, 0xF0AA, 0xF0AB, 0xF0AC, 0xF0AD, 0xF0AE, 0xF0AF, 0xF0B0, 0xF0B1, 0xF0B2, 0xF0B3, 0xF0B4, 0xF0B5, 0xF0B6, 0xF0B7, 0xF0B8, 0xF0B9, 0xF0BA, 0xF0BB, 0xF0BC, 0xF0BD, 0xF0BE, 0xF0BF, 0xF0C0, 0xF0C1, 0xF0C2, 0xF0C3, 0xF0C4, 0xF0C5, 0xF0C6, 0xF0C7, 0xF0C8, 0xF0C9, 0xF0CA, 0xF0CB, 0xF0CC, 0xF0CD, 0xF0CE, 0xF0CF, 0xF0D0, 0xF0D1, 0xF0D2, 0xF0D3, 0xF0D4, 0xF0D5, 0xF0D6, 0xF0D7, 0xF0D8, 0xF0D9, 0xF0DA, 0xF0DB, 0xF0DC, 0xF0DD, 0xF0DE, 0xF0DF, 0xF0E0, 0xF0E1, 0xF0E2, 0xF0E3, 0xF0E4, 0xF0E5, 0xF0E6, 0xF0E7, 0xF0E8, 0xF0E9, 0xF0EA, 0xF0EB, 0xF0EC, 0xF0ED, 0xF0EE, 0xF0EF, 0xF0F0, 0xF0F1, 0xF0F2, 0xF0F3, 0xF0F4, 0xF0F5, 0xF0F6, 0xF0F7, 0xF0F8, 0xF0F9, 0xF0FA, 0xF0FB, 0xF0FC, 0xF0FD, 0xF0FE, 0xF0FF];
+VT100.prototype.xtermColors = function() {
+    var colors = [];
+    var levels = [0, 95, 135, 175, 215, 255];
+    for (var i = 16; i < 256; i++) {
+        var rgb;
+        if (i < 232) {
+            rgb = (levels[Math.floor((i - 16) / 36)] << 16) | (levels[Math.floor((i - 16) / 6) % 6] << 8) | levels[(i - 16) % 6];
+        } else {
+            rgb = 0x010101 * (8 + 10 * (i - 232));
+        }
+        colors[i] = '#' + (0x1000000 | rgb).toString(16).substr(1);
+    }
+    return colors;
+}();
+VT100.prototype.escTable = function() {
+    var table = new Uint16Array(28 * 256);
+    var set = function(state, chars, entry) {
+        for (var i = 0; i < chars.length; i++) {
+            table[state * 256 + (typeof chars == 'string' ? chars.charCodeAt(i) : chars[i])] = entry;
+        }
+    };
+    var digits = '0123456789';
+    var hex = '0123456789ABCDEFabcdef';
+    var execute = [0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x84, 0x85, 0x88, 0x8D, 0x9A];
+    var chars = [[0, 0], [2, 0], [6, 0], [6, 0], [6, 0], [7, 0], [0, 0], [0, 0], [12, 0], [12, 0], [12, 0], [12, 0], [0, 0], [13, 0], [0, 14], [0, 14], [0, 0], [10, 17], [14, 0], [14, 0], [0, 0], [0, 0], [0, 0], [0, 0], [0, 0], [0, 0], [0, 0], [6, 0]];
+    for (var state = 0; state < 28; state++) {
+        var row = state * 256;
+        var action = chars[state][0] << 5 | chars[state][1];
+        for (var ch = 0; ch < 256; ch++) {
+            table[row + ch] = action;
+        }
+        set(state, execute, state == 14 ? state : 1 << 5 | state);
+        set(state, [0x00, 0x7F], state);
+        set(state, [0x18, 0x1A], 0);
+        set(state, [0x1B], 1);
+        set(state, [0x07], state == 17 ? 11 << 5 : state == 14 ? 0 : 1 << 5 | state);
+        set(state, [0x8E], 18);
+        set(state, [0x8F], 19);
+        set(state, [0x9B], 3 << 5 | 2);
+    }
+    set(1, '%', 13);
+    set(1, '(', 8);
+    set(1, ')-', 9);
+    set(1, '*.', 10);
+    set(1, '+/', 11);
+    set(1, '#', 7);
+    set(1, 'N', 18);
+    set(1, 'O', 19);
+    set(1, '[', 3 << 5 | 2);
+    set(1, ']', 15);
+    set(1, 'PX^_', 14);
+    set(2, '[', 6);
+    set(2, '?', 15 << 5 | 4);
+    for (var state = 2; state <= 5; state++) {
+        set(state, digits, 4 << 5 | (state == 2 ? 3 : state));
+        set(state, ';', 5 << 5 | (state < 4 ? 27 : state));
+    }
+    set(27, digits, 4 << 5 | 27);
+    set(27, ';', 5 << 5 | 27);
+    set(2, '>', 5);
+    set(3, '>', 5);
+    set(2, '!', 12);
+    set(3, '!', 12);
+    set(27, '!', 12);
+    set(4, '$', 16 << 5 | 4);
+    set(15, '012', 8 << 5 | 17);
+    set(15, 'P', 8 << 5 | 16);
+    set(15, 'R', 0);
+    set(16, hex, 9 << 5 | 20);
+    for (var state = 20; state < 25; state++) {
+        set(state, hex, 9 << 5 | (state + 1));
+    }
+    set(25, hex, 9 << 5);
+    table.set(table.subarray(256, 512), 26 * 256);
+    set(26, '\\', 11 << 5);
+    set(17, [0x1B], 26);
+    set(17, [0x9C], 11 << 5);
+    set(14, [0x9C], 0);
+    set(15, [0x9C], 0);
+    return table;
+}();
+VT100.prototype.printTable = function() {
+    var table = new Uint16Array(4 * 256);
+    var set = function(state, chars, entry) {
+        for (var i = 0; i < chars.length; i++) {
+            table[state * 256 + (typeof chars == 'string' ? chars.charCodeAt(i) : chars[i])] = entry;
+        }
+    };
+    for (var state = 0; state < 4; state++) {
+        var row = state * 256;
+        for (var ch = 0; ch < 256; ch++) {
+            table[row + ch] = state < 2 ? 0 : 6 << 5;
+        }
+        set(state, [0x09, 0x0A, 0x0C, 0x0D], 1 << 5 | state);
+        set(state, [0x18, 0x1A], 0);
+        set(state, [0x1B], 1);
+    }
+    set(1, '[', 2 << 5 | 2);
+    set(2, '?', 3 << 5 | 3);
+    for (var state = 2; state < 4; state++) {
+        set(state, '0123456789', 4 << 5 | 3);
+        set(state, ';', 5 << 5 | 3);
+    }
+    return table;
+}();
 VT100.prototype.ctrlAction = [true, false, false, false, false, false, false, true, true, true, true, true, true, true, true, true, false, false, false, false, false, false, false, false, true, false, true, true, false, false, false, false];
 VT100.prototype.ctrlAlways = [true, false, false, false, false, false, false, false, true, false, true, false, true, true, true, true, false, false, false, false, false, false, false, false, false, false, false, true, false, false, false, false];
 if (typeof XMLHttpRequest == 'undefined') {
@@ -3169,9 +3740,53 @@ function ShellInABox(url, container) {
         this.session = null;
     }
     this.pendingKeys = '';
-    this.keysInFlight = false;
+    this.keysRequested = false;
+    this.keyBatches = [];
+    this.keySeq = 0;
+    this.keyTimer = null;
+    this.keyRtt = 0;
+    this.maxKeyBatches = 1;
+    this.pendingOutput = [];
+    this.workerOutput = [];
+    this.outputOffset = 0;
+    this.outputScheduled = false;
+    this.pendingOutputBytes = 0;
+    this.outputBudget = 65536;
+    this.resumeOutput = null;
+    this.windowClosed = false;
+    this.queuedPosition = 0;
+    this.outputPosition = 0;
+    this.fastForwardTo = -1;
+    this.frameStarts = [];
+    this.frameTail = '';
+    this.lastMarkerAt = -1;
+    this.lastMarkerEnd = -1;
+    this.renderDeferred = false;
+    this.presentedAt = 0;
+    this.framesParsed = 0;
+    this.framesPresented = 0;
+    this.framesDropped = 0;
+    this.webSocket = null;
+    this.webSocketOpen = false;
+    this.webSocketFailed = false;
+    this.retryCount = 0;
+    this.retryTimer = null;
+    this.retryPending = false;
+    this.predictions = [];
+    this.predictionY = -1;
+    this.inputStartX = 0;
+    this.inputEntered = false;
+    this.predictionBlocked = false;
+    this.echoConfirmed = false;
     this.connected = false;
     this.superClass.constructor.call(this, container);
+    var online = function(shellInABox) { return function() { shellInABox.networkOnline(); }; }(this);
+    var offline = function(shellInABox) { return function() { shellInABox.networkOffline(); }; }(this);
+    this.addListener(window, 'online', online);
+    this.addListener(window, 'offline', offline);
+    this.addListener(document, 'online', online);
+    this.addListener(document, 'offline', offline);
+    this.addListener(document, 'resume', online);
     setTimeout(function(shellInABox) { return function() { shellInABox.sendRequest(); }; }(this), 1);
 }
 
@@ -3179,7 +3794,27 @@ function ShellInABox(url, container) {
 extend(ShellInABox, VT100);
 ShellInABox.prototype.sessionClosed = function() {
     try {
+        this.resumeOutput = null;
+        this.processOutput(0);
+        this.rollbackPredictions();
+        this.predictions = [];
         this.connected = false;
+        this.retryPending = false;
+        this.keyBatches = [];
+        if (this.keyTimer) {
+            clearTimeout(this.keyTimer);
+            this.keyTimer = null;
+        }
+        if (this.retryTimer) {
+            clearTimeout(this.retryTimer);
+            this.retryTimer = null;
+        }
+        if (this.webSocket) {
+            this.webSocket.onclose = null;
+            this.webSocket.close();
+            this.webSocket = null;
+            this.webSocketOpen = false;
+        }
         if (this.session) {
             this.session = undefined;
             if (this.cursorX > 0) {
@@ -3201,7 +3836,20 @@ ShellInABox.prototype.reconnect = function() {
                 document.location.replace(this.nextUrl);
             } else {
                 this.pendingKeys = '';
-                this.keysInFlight = false;
+                this.keysRequested = false;
+                this.keyBatches = [];
+                this.keySeq = 0;
+                this.pendingOutput = [];
+                this.workerOutput = [];
+                this.outputOffset = 0;
+                this.pendingOutputBytes = 0;
+                this.queuedPosition = 0;
+                this.outputPosition = 0;
+                this.fastForwardTo = -1;
+                this.frameStarts = [];
+                this.frameTail = '';
+                this.lastMarkerAt = -1;
+                this.lastMarkerEnd = -1;
                 this.reset(true);
                 this.sendRequest();
             }
@@ -3210,16 +3858,24 @@ ShellInABox.prototype.reconnect = function() {
     return false;
 };
 ShellInABox.prototype.sendRequest = function(request) {
+    if (request == undefined && !this.webSocketFailed && typeof WebSocket != 'undefined' && typeof TextEncoder != 'undefined' && !(typeof disableWebSocket != 'undefined' && disableWebSocket)) {
+        this.openWebSocket();
+        return;
+    }
+    if (request == undefined && !this.streamingUnsupported && this.utfDecoder && typeof fetch != 'undefined' && typeof ReadableStream != 'undefined' && !(typeof disableStreaming != 'undefined' && disableStreaming)) {
+        this.fetchStream();
+        return;
+    }
     if (request == undefined) {
         request = new XMLHttpRequest();
     }
     request.open('POST', this.url + '?', true);
     request.setRequestHeader('Cache-Control', 'no-cache');
     request.setRequestHeader('Content-Type', 'application/x-www-form-urlencoded; charset=utf-8');
-    var content = 'width=' + this.terminalWidth + '&height=' + this.terminalHeight +
-    (this.session ? '&session=' +
-        encodeURIComponent(this.session) : '&rooturl=' +
-            encodeURIComponent(this.rooturl));
+    if (this.utfDecoder) {
+        request.responseType = 'arraybuffer';
+    }
+    var content = this.pollParameters() + (this.utfDecoder ? '&binary=1' : '');
     request.setRequestHeader('Content-Length', content.length);
     request.onreadystatechange = function(shellInABox) {
         return function() {
@@ -3232,98 +3888,746 @@ ShellInABox.prototype.sendRequest = function(request) {
     }(this);
     request.send(content);
 };
+ShellInABox.prototype.pollParameters = function() {
+    return 'width=' + this.terminalWidth + '&height=' + this.terminalHeight +
+        (this.session ? '&session=' + encodeURIComponent(this.session) : '&rooturl=' + encodeURIComponent(this.rooturl)) +
+        '&window=' + this.receiveWindow();
+};
+ShellInABox.prototype.fetchStream = function() {
+    this.streamBuffer = new Uint8Array(0);
+    this.streamOutputLeft = 0;
+    this.streamSession = null;
+    this.streamClosed = false;
+    fetch(this.url + '?', {
+        method: 'POST',
+        headers: { 'Content-Type': 'application/x-www-form-urlencoded; charset=utf-8' },
+        body: this.pollParameters() + '&binary=1&stream=1',
+        cache: 'no-store'
+    }).then(function(shellInABox) {
+        return function(response) {
+            return shellInABox.readStream(response);
+        };
+    }(this)).then(null, function(shellInABox) {
+        return function() {
+            shellInABox.retryRequest();
+        };
+    }(this));
+};
+ShellInABox.prototype.readStream = function(response) {
+    if (response.status != 200) {
+        if (response.status >= 500) {
+            this.retryRequest();
+        } else {
+            this.sessionClosed();
+        }
+        return;
+    }
+    this.connected = true;
+    this.retryCount = 0;
+    var type = response.headers.get('Content-Type');
+    if (!/^application\/x-shellinabox-stream/.test(type) || !response.body) {
+        this.streamingUnsupported = true;
+        return response.arrayBuffer().then(function(shellInABox) {
+            return function(buffer) {
+                try {
+                    shellInABox.handleResponse(shellInABox.parseResponse(new Uint8Array(buffer), type, response.headers.get('X-ShellInABox-Session')));
+                } catch(e) {
+                    shellInABox.sessionClosed();
+                }
+            };
+        }(this));
+    }
+    var reader = response.body.getReader();
+    var pump = function(shellInABox) {
+        return function(result) {
+            if (result.done) {
+                shellInABox.handleResponse({ session: shellInABox.streamClosed ? null : shellInABox.streamSession });
+                return;
+            }
+            shellInABox.readStreamData(result.value);
+            return new Promise(function(resolve) {
+                shellInABox.whenDrained(resolve);
+            }).then(function() {
+                return reader.read();
+            }).then(pump);
+        };
+    }(this);
+    return reader.read().then(pump);
+};
+ShellInABox.prototype.readStreamData = function(chunk) {
+    var buffer = chunk;
+    if (this.streamBuffer.length) {
+        buffer = new Uint8Array(this.streamBuffer.length + chunk.length);
+        buffer.set(this.streamBuffer);
+        buffer.set(chunk, this.streamBuffer.length);
+    }
+    var i = 0;
+    while (i < buffer.length) {
+        if (this.streamOutputLeft) {
+            var end = i + this.streamOutputLeft < buffer.length ? i + this.streamOutputLeft : buffer.length;
+            this.queueOutput(buffer.subarray(i, end));
+            this.streamOutputLeft -= end - i;
+            i = end;
+            continue;
+        }
+        if (buffer.length - i < 5) {
+            break;
+        }
+        var length = (buffer[i + 1] << 24 | buffer[i + 2] << 16 | buffer[i + 3] << 8 | buffer[i + 4]) >>> 0;
+        if (buffer[i] == 1) {
+            this.streamOutputLeft = length;
+            i += 5;
+            continue;
+        }
+        if (buffer.length - i - 5 < length) {
+            break;
+        }
+        if (buffer[i] == 4) {
+            this.streamSession = String.fromCharCode.apply(String, buffer.subarray(i + 5, i + 5 + length));
+            if (!this.session) {
+                this.session = this.streamSession;
+            }
+        } else if (buffer[i] == 5) {
+            this.streamClosed = true;
+        }
+        i += 5 + length;
+    }
+    this.streamBuffer = buffer.subarray(i);
+};
+ShellInABox.prototype.openWebSocket = function() {
+    var url = this.url.replace(/^http/, 'ws') + '?' + this.pollParameters();
+    try {
+        this.webSocket = new WebSocket(url);
+    } catch(e) {
+        this.webSocketFailed = true;
+        this.sendRequest();
+        return;
+    }
+    this.webSocket.binaryType = 'arraybuffer';
+    this.webSocketOpen = false;
+    this.webSocket.onopen = function(shellInABox) {
+        return function() {
+            shellInABox.webSocketOpen = true;
+            shellInABox.connected = true;
+            shellInABox.retryCount = 0;
+            shellInABox.windowClosed = false;
+        };
+    }(this);
+    this.webSocket.onmessage = function(shellInABox) {
+        return function(e) {
+            try {
+                shellInABox.onWebSocketMessage(new Uint8Array(e.data));
+            } catch(e) {
+                shellInABox.sessionClosed();
+            }
+        };
+    }(this);
+    this.webSocket.onclose = function(shellInABox) {
+        return function() {
+            shellInABox.onWebSocketClose();
+        };
+    }(this);
+    this.webSocket.onerror = function(shellInABox, socket) {
+        return function() {
+            if (!shellInABox.webSocketOpen && shellInABox.webSocket == socket) {
+                socket.onclose = null;
+                shellInABox.onWebSocketClose();
+            }
+        };
+    }(this, this.webSocket);
+};
+ShellInABox.prototype.onWebSocketMessage = function(frame) {
+    switch (frame[0]) {
+    case 1:
+        this.queueOutput(frame.subarray(1));
+        break;
+    case 4:
+        this.session = String.fromCharCode.apply(String, frame.subarray(1));
+        break;
+    case 5:
+        this.sessionClosed();
+        break;
+    }
+};
+ShellInABox.prototype.onWebSocketClose = function() {
+    var opened = this.webSocketOpen;
+    this.webSocket = null;
+    this.webSocketOpen = false;
+    if (!opened && !this.isOffline()) {
+        this.webSocketFailed = true;
+        this.sendRequest();
+    } else if (this.session || !opened) {
+        this.retryRequest();
+    } else {
+        this.sessionClosed();
+    }
+};
+ShellInABox.prototype.sendFrame = function(type, data) {
+    var payload = typeof data == 'string' ? this.encodeUtf8(data) : data;
+    var frame = new Uint8Array(payload.length + 1);
+    frame[0] = type;
+    frame.set(payload, 1);
+    this.webSocket.send(frame.buffer);
+};
 ShellInABox.prototype.onReadyStateChange = function(request) {
     if (request.readyState == 4) {
         if (request.status == 200) {
             this.connected = true;
-            var response = eval('(' + request.responseText + ')');
-            if (response.data) {
-                this.vt100(response.data);
-            }
-            if (!response.session || this.session && this.session != response.session) {
-                this.sessionClosed();
-            } else {
-                this.session = response.session;
-                this.sendRequest(request);
-            }
-        } else if (request.status == 0) {
-            this.sendRequest(request);
+            this.retryCount = 0;
+            this.handleResponse(this.readResponse(request), request);
+        } else if (request.status == 0 || request.status >= 500) {
+            this.retryRequest();
         } else {
             this.sessionClosed();
         }
     }
 };
+ShellInABox.prototype.isOffline = function() {
+    return typeof navigator != 'undefined' && navigator.onLine === false;
+};
+ShellInABox.prototype.retryRequest = function() {
+    if (this.retryTimer) {
+        clearTimeout(this.retryTimer);
+        this.retryTimer = null;
+    }
+    if (!this.session && this.retryCount >= 8) {
+        this.retryPending = false;
+        this.retryCount = 0;
+        this.sessionClosed();
+        return;
+    }
+    this.retryPending = true;
+    if (this.isOffline()) {
+        return;
+    }
+    var delay = Math.min(30000, 500 << Math.min(this.retryCount++, 6));
+    this.retryTimer = setTimeout(function(shellInABox) {
+        return function() {
+            shellInABox.retryTimer = null;
+            shellInABox.retryPending = false;
+            shellInABox.sendRequest();
+        };
+    }(this), delay / 2 + Math.random() * delay / 2);
+};
+ShellInABox.prototype.networkOnline = function() {
+    if (this.retryPending) {
+        if (this.retryTimer) {
+            clearTimeout(this.retryTimer);
+            this.retryTimer = null;
+        }
+        this.retryPending = false;
+        this.sendRequest();
+    }
+};
+ShellInABox.prototype.networkOffline = function() {
+    if (this.retryTimer) {
+        clearTimeout(this.retryTimer);
+        this.retryTimer = null;
+    }
+};
+ShellInABox.prototype.handleResponse = function(response, request) {
+    if (response.data) {
+        this.queueOutput(response.data);
+    }
+    if (!response.session || this.session && this.session != response.session) {
+        this.sessionClosed();
+    } else {
+        this.session = response.session;
+        this.whenDrained(function(shellInABox) {
+            return function() {
+                shellInABox.sendRequest(request);
+            };
+        }(this));
+    }
+};
+ShellInABox.prototype.readResponse = function(request) {
+    if (request.responseType != 'arraybuffer') {
+        return JSON.parse(request.responseText);
+    }
+    return this.parseResponse(new Uint8Array(request.response), request.getResponseHeader('Content-Type'), request.getResponseHeader('X-ShellInABox-Session'));
+};
+ShellInABox.prototype.parseResponse = function(bytes, type, session) {
+    if (/^application\/octet-stream/.test(type)) {
+        this.queueOutput(bytes);
+        return { session: session };
+    }
+    return JSON.parse(new TextDecoder('utf-8').decode(bytes));
+};
+ShellInABox.prototype.queueOutput = function(data) {
+    if (data.length) {
+        this.pendingOutput.push(data);
+        this.pendingOutputBytes += data.length;
+        this.scanFrames(data);
+        this.queuedPosition += data.length;
+        if (this.pendingOutputBytes > this.outputBudget && this.webSocketOpen && !this.windowClosed) {
+            this.windowClosed = true;
+            this.sendWindow(0);
+        }
+        if (!this.outputScheduled) {
+            this.scheduleOutput();
+        }
+    }
+};
+ShellInABox.prototype.receiveWindow = function() {
+    return this.pendingOutputBytes < this.outputBudget ? this.outputBudget - this.pendingOutputBytes : 0;
+};
+ShellInABox.prototype.sendWindow = function(size) {
+    this.sendFrame(7, new Uint8Array([size >>> 24, size >> 16 & 0xFF, size >> 8 & 0xFF, size & 0xFF]));
+};
+ShellInABox.prototype.whenDrained = function(resume) {
+    if (this.pendingOutputBytes > this.outputBudget) {
+        this.resumeOutput = resume;
+    } else {
+        resume();
+    }
+};
+ShellInABox.prototype.outputDrained = function() {
+    if (this.windowClosed) {
+        this.windowClosed = false;
+        if (this.webSocketOpen) {
+            this.sendWindow(this.receiveWindow());
+        }
+    }
+    var resume = this.resumeOutput;
+    if (resume) {
+        this.resumeOutput = null;
+        resume();
+    }
+};
+ShellInABox.prototype.scheduleOutput = function() {
+    this.outputScheduled = true;
+    var process = function(shellInABox) {
+        return function() {
+            shellInABox.outputScheduled = false;
+            try {
+                shellInABox.processOutput(8);
+            } catch(e) {
+                shellInABox.sessionClosed();
+            }
+        };
+    }(this);
+    if (typeof MessageChannel != 'undefined') {
+        if (!this.outputChannel) {
+            this.outputChannel = new MessageChannel();
+        }
+        this.outputChannel.port1.onmessage = process;
+        this.outputChannel.port2.postMessage('');
+    } else {
+        setTimeout(process, 0);
+    }
+};
+ShellInABox.prototype.processOutput = function(timeLimit) {
+    var clock = typeof performance != 'undefined' && performance.now ? performance : Date;
+    var started = clock.now();
+    while (this.pendingOutput.length) {
+        var data = this.pendingOutput[0];
+        if (this.worker) {
+            this.pendingOutput.shift();
+            this.workerOutput.push(data);
+            this.postToWorker(data, false, data.length);
+            continue;
+        }
+        var end = this.outputOffset + 4096;
+        if (end >= data.length) {
+            end = data.length;
+            this.pendingOutput.shift();
+        }
+        var start = this.outputOffset;
+        this.outputOffset = end < data.length ? end : 0;
+        this.rollbackPredictions();
+        if (typeof data == 'string') {
+            this.respond(this.vt100(data.substring(start, end)));
+        } else {
+            this.respond(this.vt100Bytes(data.subarray(start, end)));
+        }
+        this.reconcilePredictions();
+        this.outputParsed(end - start);
+        if (timeLimit && this.pendingOutput.length && (clock.now() - started >= timeLimit || typeof navigator != 'undefined' && navigator.scheduling && navigator.scheduling.isInputPending && navigator.scheduling.isInputPending())) {
+            this.scheduleOutput();
+            return;
+        }
+    }
+};
+ShellInABox.prototype.outputParsed = function(length) {
+    this.outputPosition += length;
+    while (this.frameStarts.length && this.frameStarts[0] < this.outputPosition) {
+        this.frameStarts.shift();
+        this.framesParsed++;
+    }
+    if (this.renderDeferred && this.outputPosition >= this.fastForwardTo) {
+        this.renderDeferred = false;
+        this.scheduleRender();
+    }
+    this.pendingOutputBytes -= length;
+    if (this.pendingOutputBytes <= this.outputBudget / 2 && (this.resumeOutput || this.windowClosed)) {
+        this.outputDrained();
+    }
+};
+ShellInABox.prototype.applyWorkerBatch = function(batch) {
+    this.superClass.applyWorkerBatch.call(this, batch);
+    var length = 0;
+    while (length < batch.consumed && this.workerOutput.length) {
+        length += this.workerOutput.shift().length;
+    }
+    if (length) {
+        this.outputParsed(length);
+    }
+};
+ShellInABox.prototype.workerFailed = function() {
+    this.superClass.workerFailed.call(this);
+    this.pendingOutput = this.workerOutput.concat(this.pendingOutput);
+    this.workerOutput = [];
+    if (this.pendingOutput.length && !this.outputScheduled) {
+        this.scheduleOutput();
+    }
+};
+ShellInABox.prototype.frameMarkers = ['\u001B[2J', '\u001B[H\u001B[J', '\u001B[?2026h'];
+ShellInABox.prototype.matchFrameMarker = function(data, i) {
+    for (var m = 0; m < this.frameMarkers.length; m++) {
+        var marker = this.frameMarkers[m];
+        if (i + marker.length > data.length) {
+            continue;
+        }
+        for (var k = 1; k < marker.length; k++) {
+            if ((typeof data == 'string' ? data.charCodeAt(i + k) : data[i + k]) != marker.charCodeAt(k)) {
+                break;
+            }
+        }
+        if (k == marker.length) {
+            return marker.length;
+        }
+    }
+    return 0;
+};
+ShellInABox.prototype.scanFrames = function(data) {
+    var text = typeof data == 'string';
+    var tail = this.frameTail;
+    if (tail) {
+        var joined = tail;
+        for (var i = 0; i < data.length && i < 7; i++) {
+            joined += text ? data.charAt(i) : String.fromCharCode(data[i]);
+        }
+        for (var i = joined.indexOf('\u001B'); i >= 0 && i < tail.length; i = joined.indexOf('\u001B', i + 1)) {
+            this.addFrameStart(this.queuedPosition - tail.length + i, this.matchFrameMarker(joined, i));
+        }
+    }
+    var escape = text ? '\u001B' : 0x1B;
+    for (var i = data.indexOf(escape); i >= 0; i = data.indexOf(escape, i + 1)) {
+        this.addFrameStart(this.queuedPosition + i, this.matchFrameMarker(data, i));
+    }
+    for (var i = data.length > 7 ? data.length - 7 : 0; i < data.length; i++) {
+        tail += text ? data.charAt(i) : String.fromCharCode(data[i]);
+    }
+    this.frameTail = tail.substr(tail.length > 7 ? tail.length - 7 : 0);
+};
+ShellInABox.prototype.addFrameStart = function(position, length) {
+    if (!length || position <= this.lastMarkerAt) {
+        return;
+    }
+    if (position != this.lastMarkerEnd) {
+        this.frameStarts.push(position);
+        if (!(typeof disableFastForward != 'undefined' && disableFastForward)) {
+            this.fastForwardTo = position;
+        }
+    }
+    this.lastMarkerAt = position;
+    this.lastMarkerEnd = position + length;
+};
+ShellInABox.prototype.flush = function() {
+    var clock = typeof performance != 'undefined' && performance.now ? performance : Date;
+    if (this.outputPosition < this.fastForwardTo && clock.now() - this.presentedAt < 250) {
+        this.renderPending = false;
+        this.renderDeferred = true;
+        return;
+    }
+    this.renderDeferred = false;
+    this.superClass.flush.call(this);
+    if (!this.synchronizedOutput) {
+        this.presentedAt = clock.now();
+        if (this.framesParsed - this.framesPresented > 1) {
+            this.framesDropped += this.framesParsed - this.framesPresented - 1;
+        }
+        this.framesPresented = this.framesParsed;
+    }
+};
 ShellInABox.prototype.sendKeys = function(keys) {
     if (!this.connected) {
         return;
     }
-    if (this.keysInFlight || this.session == undefined) {
-        this.pendingKeys += keys;
+    this.pendingKeys += keys;
+    this.keysRequested = true;
+    if (this.session == undefined || this.keyTimer) {
+        return;
+    }
+    if (!this.keyBatches.length) {
+        this.flushKeys();
     } else {
-        this.keysInFlight = true;
-        keys = this.pendingKeys + keys;
-        this.pendingKeys = '';
-        var request = new XMLHttpRequest();
-        request.open('POST', this.url + '?', true);
-        request.setRequestHeader('Cache-Control', 'no-cache');
-        request.setRequestHeader('Content-Type', 'application/x-www-form-urlencoded; charset=utf-8');
-        var content = 'width=' + this.terminalWidth + '&height=' + this.terminalHeight + '&session=' + encodeURIComponent(this.session) + '&keys=' + encodeURIComponent(keys);
-        request.setRequestHeader('Content-Length', content.length);
-        request.onreadystatechange = function(shellInABox) {
+        this.keyTimer = setTimeout(function(shellInABox) {
             return function() {
-                try {
-                    return shellInABox.keyPressReadyStateChange(request);
-                } catch(e) {
+                shellInABox.flushKeys();
+            };
+        }(this), this.keyRtt < 200 ? this.keyRtt / 4 : 50);
+    }
+};
+ShellInABox.prototype.flushKeys = function() {
+    if (this.keyTimer) {
+        clearTimeout(this.keyTimer);
+        this.keyTimer = null;
+    }
+    if (!this.keysRequested || this.session == undefined || this.keyBatches.length && this.keySeq - this.keyBatches[0].seq >= this.maxKeyBatches) {
+        return;
+    }
+    var batch = { seq: this.keySeq++, keys: this.pendingKeys, retries: 0 };
+    this.pendingKeys = '';
+    this.keysRequested = false;
+    this.keyBatches.push(batch);
+    this.postKeys(batch);
+};
+ShellInABox.prototype.postKeys = function(batch) {
+    var request = new XMLHttpRequest();
+    request.open('POST', this.url + '?', true);
+    request.setRequestHeader('Cache-Control', 'no-cache');
+    request.setRequestHeader('Content-Type', 'application/x-www-form-urlencoded; charset=utf-8');
+    var content = 'width=' + this.terminalWidth + '&height=' + this.terminalHeight + '&session=' + encodeURIComponent(this.session) + '&seq=' + batch.seq + '&keys=' + batch.keys;
+    request.setRequestHeader('Content-Length', content.length);
+    request.onreadystatechange = function(shellInABox) {
+        return function() {
+            try {
+                return shellInABox.keyPressReadyStateChange(request, batch);
+            } catch(e) {
+            }
+        };
+    }(this);
+    batch.sent = new Date().getTime();
+    request.send(content);
+};
+ShellInABox.prototype.keyPressReadyStateChange = function(request, batch) {
+    if (request.readyState != 4) {
+        return;
+    }
+    var i = this.keyBatches.indexOf(batch);
+    if (i < 0) {
+        return;
+    }
+    if (request.status == 200) {
+        var rtt = new Date().getTime() - batch.sent;
+        this.keyRtt = this.keyRtt ? (7 * this.keyRtt + rtt) / 8 : rtt;
+        if (request.getResponseHeader('X-ShellInABox-Seq') != null) {
+            this.maxKeyBatches = 4;
+        }
+    } else if (request.status == 0 || request.status >= 500) {
+        setTimeout(function(shellInABox) {
+            return function() {
+                if (shellInABox.keyBatches.indexOf(batch) >= 0) {
+                    shellInABox.postKeys(batch);
                 }
             };
-        }(this);
-        request.send(content);
+        }(this), 100 << Math.min(batch.retries++, 5));
+        return;
+    } else {
+        this.sessionClosed();
+        return;
     }
+    this.keyBatches.splice(i, 1);
+    this.flushKeys();
 };
-ShellInABox.prototype.keyPressReadyStateChange = function(request) {
-    if (request.readyState == 4) {
-        this.keysInFlight = false;
-        if (this.pendingKeys) {
-            this.sendKeys('');
+ShellInABox.prototype.respond = function(s) {
+    if (s) {
+        if (this.webSocketOpen) {
+            this.sendFrame(6, s);
+        } else {
+            this.sendKeys(this.encodeKeys(s));
         }
     }
 };
 ShellInABox.prototype.keysPressed = function(ch) {
+    this.predictEcho(ch);
+    if (this.webSocketOpen) {
+        this.sendFrame(2, ch);
+    } else {
+        this.sendKeys(this.encodeKeys(ch));
+    }
+};
+ShellInABox.prototype.hexBytes = function() {
     var hex = '0123456789ABCDEF';
-    var s = '';
-    for (var i = 0; i < ch.length; i++) {
-        var c = ch.charCodeAt(i);
-        if (c < 128) {
-            s += hex.charAt(c >> 4) + hex.charAt(c & 0xF);
+    var table = [];
+    for (var i = 0; i < 256; i++) {
+        table[i] = hex.charAt(i >> 4) + hex.charAt(i & 0xF);
+    }
+    return table;
+}();
+ShellInABox.prototype.encodeUtf8 = function(s) {
+    if (typeof TextEncoder != 'undefined') {
+        if (!this.textEncoder) {
+            this.textEncoder = new TextEncoder();
+        }
+        return this.textEncoder.encode(s);
+    }
+    var bytes = [];
+    for (var i = 0; i < s.length; i++) {
+        var c = s.charCodeAt(i);
+        if (c >= 0xD800 && c < 0xDC00 && (s.charCodeAt(i + 1) & 0xFC00) == 0xDC00) {
+            c = 0x10000 + (c - 0xD800 << 10) + s.charCodeAt(++i) - 0xDC00;
+        } else if (c >= 0xD800 && c < 0xE000) {
+            c = 0xFFFD;
+        }
+        if (c < 0x80) {
+            bytes.push(c);
         } else if (c < 0x800) {
-            s += hex.charAt(0xC + (c >> 10)) +
-                hex.charAt((c >> 6) & 0xF) +
-                hex.charAt(0x8 + ((c >> 4) & 0x3)) +
-                hex.charAt(c & 0xF);
+            bytes.push(0xC0 | c >> 6, 0x80 | c & 0x3F);
         } else if (c < 0x10000) {
-            s += 'E' +
-                hex.charAt((c >> 12)) +
-                hex.charAt(0x8 + (c >> 10) & 0x3) +
-                hex.charAt((c >> 6) & 0xF) +
-                hex.charAt(0x8 + ((c >> 4) & 0x3)) +
-                hex.charAt(c & 0xF);
-        } else if (c < 0x110000) {
-            s += 'F' +
-                hex.charAt((c >> 18)) +
-                hex.charAt(0x8 + (c >> 16) & 0x3) +
-                hex.charAt((c >> 12) & 0xF) +
-                hex.charAt(0x8 + (c >> 10) & 0x3) +
-                hex.charAt((c >> 6) & 0xF) +
-                hex.charAt(0x8 + ((c >> 4) & 0x3)) +
-                hex.charAt(c & 0xF);
-        }
-    }
-    this.sendKeys(s);
+            bytes.push(0xE0 | c >> 12, 0x80 | c >> 6 & 0x3F, 0x80 | c & 0x3F);
+        } else {
+            bytes.push(0xF0 | c >> 18, 0x80 | c >> 12 & 0x3F, 0x80 | c >> 6 & 0x3F, 0x80 | c & 0x3F);
+        }
+    }
+    return bytes;
+};
+ShellInABox.prototype.encodeKeys = function(ch) {
+    var bytes = this.encodeUtf8(ch);
+    var s = new Array(bytes.length);
+    for (var i = 0; i < bytes.length; i++) {
+        s[i] = this.hexBytes[bytes[i]];
+    }
+    return s.join('');
+};
+ShellInABox.prototype.predictEcho = function(ch) {
+    var x = this.cursorX;
+    var y = this.cursorY;
+    var line = this.lines[this.currentScreen][y];
+    var op = null;
+    if (ch == '\r') {
+        this.inputEntered = true;
+    } else if (!this.predictionBlocked && !this.worker && this.session && !(typeof disableLocalEcho != 'undefined' && disableLocalEcho) && !this.mouseReporting && !this.currentScreen && !this.insertMode && !this.printing && this.isEsc == 0 && !this.needWrap && !this.cursor.style.visibility && line && !/\b(pass(word|phrase|code)?|pin)\b[^:]*:\s*$/i.test(this.codePointsToString(line.chars.subarray(0, x)))) {
+        if (!this.predictions.length && (this.predictionY != y || this.inputEntered)) {
+            this.predictionY = y;
+            this.inputStartX = x;
+            this.inputEntered = false;
+        }
+        if (this.predictionY == y) {
+            var c = ch.length == 1 ? ch.charCodeAt(0) : 0;
+            if ((c >= 0x20 && c < 0x7F || c >= 0xA0 && c < 0xD800) && x < this.terminalWidth - 1 && this.isBlankAfter(line, x)) {
+                op = { x: x, nx: x + 1, cells: [[x, c]] };
+            } else if ((c == 0x7F || c == 0x08) && x > this.inputStartX && this.isBlankAfter(line, x)) {
+                op = { x: x, nx: x - 1, cells: [[x - 1, 0x20]] };
+            } else if ((ch == '\u001B[D' || ch == '\u001BOD') && x > this.inputStartX) {
+                op = { x: x, nx: x - 1, cells: [] };
+            } else if ((ch == '\u001B[C' || ch == '\u001BOC') && !this.isBlankAfter(line, x)) {
+                op = { x: x, nx: x + 1, cells: [] };
+            }
+        }
+    }
+    if (!op) {
+        this.predictionBlocked = true;
+        return;
+    }
+    this.predictions.push(op);
+    this.applyPrediction(op);
+    if (!op.shown) {
+        this.predictionBlocked = true;
+    }
+};
+ShellInABox.prototype.isBlankAfter = function(line, x) {
+    for (var i = line.chars.length; i-- > x;) {
+        if (line.chars[i] != 0x20) {
+            return false;
+        }
+    }
+    return true;
+};
+ShellInABox.prototype.applyPrediction = function(op) {
+    var line = this.lines[0][this.predictionY];
+    op.saved = [];
+    op.shown = this.echoConfirmed;
+    if (!op.shown) {
+        return;
+    }
+    for (var i = 0; i < op.cells.length; i++) {
+        var x = op.cells[i][0];
+        var c = op.cells[i][1];
+        op.saved.push([x, line.chars[x], line.attrs[x]]);
+        line.chars[x] = c;
+        line.attrs[x] = c == 0x20 ? this.attr : this.attr | 0x0200;
+    }
+    this.cursorX = op.nx;
+    this.invalidateLine(this.predictionY);
+};
+ShellInABox.prototype.rollbackPredictions = function() {
+    var ops = this.predictions;
+    if (!ops.length || !ops[0].shown) {
+        return;
+    }
+    var line = this.lines[0][this.predictionY];
+    for (var k = ops.length; k--;) {
+        for (var i = ops[k].saved.length; i--;) {
+            var saved = ops[k].saved[i];
+            line.chars[saved[0]] = saved[1];
+            line.attrs[saved[0]] = saved[2];
+        }
+    }
+    this.cursorX = ops[0].x;
+    this.invalidateLine(this.predictionY);
+};
+ShellInABox.prototype.reconcilePredictions = function() {
+    var blocked = this.predictionBlocked;
+    this.predictionBlocked = false;
+    var ops = this.predictions;
+    if (!ops.length) {
+        return;
+    }
+    var line = this.lines[this.currentScreen][this.cursorY];
+    if (this.currentScreen || this.cursorY != this.predictionY || !line) {
+        this.predictions = [];
+        return;
+    }
+    var matched = -1;
+    var expected = {};
+    for (var k = 0; k < ops.length; k++) {
+        for (var i = 0; i < ops[k].cells.length; i++) {
+            expected[ops[k].cells[i][0]] = ops[k].cells[i][1];
+        }
+        if (this.cursorX == ops[k].nx) {
+            matched = k;
+            for (var x in expected) {
+                if (line.chars[x] != expected[x]) {
+                    matched = -1;
+                    break;
+                }
+            }
+        }
+    }
+    if (matched >= 0) {
+        this.echoConfirmed = true;
+        ops.splice(0, matched + 1);
+    } else if (this.cursorX != ops[0].x) {
+        if (!blocked) {
+            this.echoConfirmed = false;
+        }
+        this.predictions = [];
+        return;
+    }
+    for (var k = 0; k < ops.length; k++) {
+        this.applyPrediction(ops[k]);
+    }
+};
+ShellInABox.prototype.resizer = function() {
+    this.rollbackPredictions();
+    this.predictions = [];
+    this.superClass.resizer.call(this);
 };
 ShellInABox.prototype.resized = function(w, h) {
-    if (this.session) {
+    if (w == this.sentWidth && h == this.sentHeight) {
+        return;
+    }
+    if (this.webSocketOpen) {
+        this.sendFrame(3, new Uint8Array([w >> 8, w & 0xFF, h >> 8, h & 0xFF]));
+    } else if (this.session) {
         this.sendKeys('');
+    } else {
+        return;
     }
+    this.sentWidth = w;
+    this.sentHeight = h;
 };
 ShellInABox.prototype.toggleSSL = function() {
     if (document.location.hash != '') {
@@ -3380,4 +4684,183 @@ ShellInABox.prototype.extendContextMenu = function(entries, actions) {
 ShellInABox.prototype.about = function() {
     alert("Shell In A Box version " + "2.10 (revision 186)" + "\nCopyright 2008-2009 by Markus Gutschke\n" + "For more information check http://shellinabox.com" +
         (typeof serverSupportsSSL != 'undefined' && serverSupportsSSL ? "\n\n" + "This product includes software developed by the OpenSSL Project\n" + "for use in the OpenSSL Toolkit. (http://www.openssl.org/)\n" + "\n" + "This product includes cryptographic software written by " + "Eric Young\n(eay@cryptsoft.com)" : ""));
-};
\ No newline at end of file
+};
+function VT100Parser(width, height, utfEnabled, maxScrollbackLines) {
+    this.terminalWidth = width;
+    this.terminalHeight = height;
+    this.utfPreferred = utfEnabled;
+    this.maxScrollbackLines = maxScrollbackLines;
+    this.console = [{ style: {} }, { style: {} }];
+    this.cursor = { style: { visibility: '' } };
+    this.canvas = null;
+    this.nextLineId = 0;
+    this.sentTrueColors = 0;
+    this.scrollbackOps = [];
+    this.pushedLines = [];
+    this.bell = false;
+    this.flash = false;
+    this.print = false;
+    this.historyCleared = false;
+    this.consumed = 0;
+    this.renderPending = false;
+    this.numScrollbackLines = 0;
+    this.initializeModel();
+    this.reset(true);
+}
+
+;
+extend(VT100Parser, VT100);
+VT100Parser.prototype.createLine = function(width, attr) {
+    var line = this.superClass.createLine.call(this, width, attr);
+    line.id = this.nextLineId++;
+    line.dirty = true;
+    return line;
+};
+VT100Parser.prototype.pushScrollback = function(line) {
+    this.superClass.pushScrollback.call(this, line);
+    delete this.scrollbackCache[this.scrollbackTotal - 1];
+    this.scrollbackOps.push(line.id);
+    this.pushedLines.push(line);
+};
+VT100Parser.prototype.popScrollback = function(width) {
+    this.scrollbackOps.push(-1);
+    return this.superClass.popScrollback.call(this, width);
+};
+VT100Parser.prototype.discardLine = function(line) {
+};
+VT100Parser.prototype.reset = function(clearHistory) {
+    if (clearHistory) {
+        this.scrollbackOps = [];
+        this.pushedLines = [];
+        this.historyCleared = true;
+        this.trueColors = [];
+        this.trueColorIds = {};
+        this.attrStyles = [];
+        this.sentTrueColors = 0;
+    }
+    this.superClass.reset.call(this, clearHistory);
+};
+VT100Parser.prototype.resize = function(width, height) {
+    var oldTerminalHeight = this.terminalHeight;
+    this.terminalWidth = width;
+    this.terminalHeight = height;
+    this.resizeScreen(oldTerminalHeight);
+};
+VT100Parser.prototype.resizer = function() {
+    this.resizeScreen(this.terminalHeight);
+};
+VT100Parser.prototype.refreshInvertedState = function() {
+    this.scheduleRender();
+};
+VT100Parser.prototype.flashScreen = function() {
+    this.flash = true;
+    this.scheduleRender();
+};
+VT100Parser.prototype.beep = function() {
+    this.bell = true;
+    this.scheduleRender();
+};
+VT100Parser.prototype.csii = function(number) {
+    if (number == 0) {
+        this.print = true;
+        this.scheduleRender();
+    }
+};
+VT100Parser.prototype.flush = function() {
+    this.renderPending = false;
+    if (this.synchronizedOutput) {
+        return;
+    }
+    var dirty = [];
+    for (var i = 0; i < this.pushedLines.length; i++) {
+        if (this.pushedLines[i].dirty) {
+            dirty.push(this.pushedLines[i]);
+        }
+    }
+    var screens = [];
+    for (var s = 0; s < 2; s++) {
+        var lines = this.lines[s];
+        screens[s] = new Int32Array(lines.length);
+        for (var i = 0; i < lines.length; i++) {
+            screens[s][i] = lines[i].id;
+            if (lines[i].dirty) {
+                dirty.push(lines[i]);
+            }
+        }
+    }
+    var size = 0;
+    for (var i = 0; i < dirty.length; i++) {
+        size += 2 + 2 * dirty[i].chars.length;
+    }
+    var rows = new Uint32Array(size);
+    for (var i = 0, j = 0; i < dirty.length; i++) {
+        var line = dirty[i];
+        var width = line.chars.length;
+        rows[j++] = line.id;
+        rows[j++] = width;
+        rows.set(line.chars, j);
+        rows.set(line.attrs, j + width);
+        j += 2 * width;
+        line.dirty = false;
+    }
+    var ops = new Int32Array(this.scrollbackOps);
+    postMessage({
+        consumed: this.consumed,
+        rows: rows.buffer,
+        scrollback: ops.buffer,
+        screens: [screens[0].buffer, screens[1].buffer],
+        state: {
+            clear: this.historyCleared,
+            currentScreen: this.currentScreen,
+            cursorX: this.cursorX,
+            cursorY: this.cursorY,
+            cursorHidden: this.cursor.style.visibility == 'hidden',
+            isInverted: this.isInverted,
+            cursorKeyMode: this.cursorKeyMode,
+            applKeyMode: this.applKeyMode,
+            crLfMode: this.crLfMode,
+            mouseReporting: this.mouseReporting,
+            utfEnabled: this.utfEnabled,
+            trueColors: this.trueColors.slice(this.sentTrueColors),
+            bell: this.bell,
+            flash: this.flash,
+            print: this.print
+        }
+    }, [rows.buffer, ops.buffer, screens[0].buffer, screens[1].buffer]);
+    this.scrollbackOps = [];
+    this.pushedLines = [];
+    this.historyCleared = false;
+    this.consumed = 0;
+    this.sentTrueColors = this.trueColors.length;
+    this.bell = false;
+    this.flash = false;
+    this.print = false;
+};
+if (typeof importScripts != 'undefined' && typeof document == 'undefined') {
+    onmessage = function(parser) {
+        return function(e) {
+            var msg = e.data;
+            var response = '';
+            if (msg.init) {
+                parser = new VT100Parser(msg.init[0], msg.init[1], msg.init[2], msg.init[3]);
+            } else if (msg.resize) {
+                parser.resize(msg.resize[0], msg.resize[1]);
+            } else if (msg.reset != undefined) {
+                parser.reset(msg.reset);
+            } else if (msg.utf != undefined) {
+                parser.utfEnabled = parser.utfPreferred = msg.utf;
+            } else if (msg.bytes) {
+                response = parser.vt100Bytes(new Uint8Array(msg.bytes));
+            } else {
+                response = parser.vt100(msg.data, msg.decoded);
+            }
+            if (msg.consumed) {
+                parser.consumed += msg.consumed;
+                parser.scheduleRender();
+            }
+            if (response) {
+                postMessage({ respond: response });
+            }
+        };
+    }(null);
+}